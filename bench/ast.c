@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+#include "../src/arena.h"
+#include "../src/ast.h"
+#include "../src/ast_flat.h"
+#include "../src/iloc_generator.h"
+#include "../src/intern.h"
+#include "../src/lexer.h"
+#include "../src/parser.h"
+#include "../src/scanner.h"
+
+#define FIELD_COUNT 100
+#define METHOD_COUNT 20000
+#define ROUNDS 20
+#define AST_FILE "/tmp/walrus-bench.ast"
+
+
+/**
+ * Counts nodes and sums up int literals top-down, the way most passes visit.
+ */
+static unsigned long visit_pointer(ASTNode* node)
+{
+    unsigned long checksum = node->kind;
+    if (node->kind == AST_INT_LITERAL) {
+        checksum += node->value.int_value;
+    }
+
+    for (int i = 0; i < node->child_count; i++) {
+        checksum += visit_pointer(node->children[i]);
+    }
+
+    return checksum;
+}
+
+/**
+ * Counts nodes and sums up int literals in storage order.
+ */
+static unsigned long visit_flat(ASTFlat* ast)
+{
+    unsigned long checksum = 0;
+    for (ASTIndex i = 0; i < ast->node_count; i++) {
+        checksum += ast->nodes[i].kind;
+        if (ast->nodes[i].kind == AST_INT_LITERAL) {
+            checksum += ast->nodes[i].value.int_value;
+        }
+    }
+
+    return checksum;
+}
+
+/**
+ * Works out the height of every subtree bottom-up, the way type checking
+ * visits expressions.
+ */
+static unsigned long height_pointer(ASTNode* node, unsigned long* checksum)
+{
+    unsigned long height = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        unsigned long child = height_pointer(node->children[i], checksum);
+        if (child > height) {
+            height = child;
+        }
+    }
+
+    *checksum += height + 1;
+    return height + 1;
+}
+
+/**
+ * Works out the height of every subtree bottom-up; children always come after
+ * their parents, so walking backwards sees children first.
+ */
+static unsigned long height_flat(ASTFlat* ast, unsigned int* heights)
+{
+    unsigned long checksum = 0;
+    for (ASTIndex i = ast->node_count; i-- > 0;) {
+        unsigned int height = 0;
+        for (uint32_t c = 0; c < ast->nodes[i].child_count; c++) {
+            unsigned int child = heights[ast_flat_get_child(ast, i, c)];
+            if (child > height) {
+                height = child;
+            }
+        }
+
+        heights[i] = height + 1;
+        checksum += height + 1;
+    }
+
+    return checksum;
+}
+
+/**
+ * Writes a flat tree to a binary file and maps it back in, checking that the
+ * loaded tree is the same as the original.
+ */
+static void run_binary(ASTFlat* flat)
+{
+    double start = bench_now();
+    ast_flat_write(flat, AST_FILE);
+    double write = bench_now() - start;
+
+    start = bench_now();
+    ASTFlat* loaded = ast_flat_load(AST_FILE);
+    double load = bench_now() - start;
+
+    if (loaded == NULL) {
+        return;
+    }
+
+    // compare nodes by their fields rather than their bytes
+    unsigned long checksum = visit_flat(loaded);
+    int same = loaded->node_count == flat->node_count
+        && checksum == visit_flat(flat)
+        && strcmp(loaded->file, flat->file) == 0;
+    for (ASTIndex i = 0; same && i < flat->node_count; i++) {
+        const char* string = ast_flat_get_string(flat, i);
+        const char* loaded_string = ast_flat_get_string(loaded, i);
+        same = flat->nodes[i].end == loaded->nodes[i].end
+            && flat->nodes[i].type == loaded->nodes[i].type
+            && (string == NULL ? loaded_string == NULL : strcmp(string, loaded_string) == 0);
+    }
+
+    printf("binary   write  %8.2f ms, load %.2f ms, %.1f MB (%s)\n",
+        write * 1e3, load * 1e3, loaded->mapping_size / 1e6, same ? "same tree" : "DIFFERENT TREE");
+
+    ast_flat_destroy(&loaded);
+    unlink(AST_FILE);
+}
+
+int main(void)
+{
+    char* source = bench_generate_program(FIELD_COUNT, METHOD_COUNT);
+
+    ScannerContext* context = scanner_open_string(source);
+    Lexer* lexer = lexer_create_bounded(context, PARSER_MAX_LOOKAHEAD);
+    Arena* arena = arena_create();
+    ASTNode* root = parser_parse(lexer, arena);
+
+    double start = bench_now();
+    ASTFlat* flat = ast_flat_create(root);
+    double flatten = bench_now() - start;
+    unsigned int* heights = malloc(sizeof(unsigned int) * flat->node_count);
+
+    printf("%u nodes in %.1f MB of arena, flattened in %.2f ms\n",
+        flat->node_count, arena_get_size(arena) / 1e6, flatten * 1e3);
+
+    for (int flat_pass = 0; flat_pass < 2; flat_pass++) {
+        const char* name = flat_pass ? "flat" : "pointer";
+        unsigned long checksum = 0;
+
+        start = bench_now();
+        for (int round = 0; round < ROUNDS; round++) {
+            checksum += flat_pass ? visit_flat(flat) : visit_pointer(root);
+        }
+        printf("%-8s visit  %8.2f ms/pass (checksum %lu)\n", name, (bench_now() - start) * 1e3 / ROUNDS, checksum);
+
+        checksum = 0;
+        start = bench_now();
+        for (int round = 0; round < ROUNDS; round++) {
+            if (flat_pass) {
+                checksum += height_flat(flat, heights);
+            } else {
+                height_pointer(root, &checksum);
+            }
+        }
+        printf("%-8s height %8.2f ms/pass (checksum %lu)\n", name, (bench_now() - start) * 1e3 / ROUNDS, checksum);
+
+        long instructions = 0;
+        start = bench_now();
+        for (int round = 0; round < ROUNDS; round++) {
+            ILOCProgram* program = flat_pass ? iloc_generator_generate_flat(flat) : iloc_generator_generate(root);
+            for (ILOCInstruction* i = program->first; i != NULL; i = i->next) {
+                instructions++;
+            }
+            iloc_program_destroy(&program);
+        }
+        printf("%-8s iloc   %8.2f ms/pass (%ld instructions)\n", name, (bench_now() - start) * 1e3 / ROUNDS, instructions);
+    }
+
+    run_binary(flat);
+
+    free(heights);
+    ast_flat_destroy(&flat);
+    arena_destroy(&arena);
+    lexer_destroy(&lexer);
+    scanner_close(&context);
+    intern_clear();
+    free(source);
+    return error_get_last();
+}
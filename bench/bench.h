@@ -0,0 +1,58 @@
+#ifndef WALRUS_BENCH_H
+#define WALRUS_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../src/pass_manager.h"
+
+
+/**
+ * Gets the current time in seconds, on the same clock as pass timings.
+ *
+ * @return The current time in seconds.
+ */
+static inline double bench_now(void)
+{
+    return pass_manager_now();
+}
+
+/**
+ * Generates a program with the given number of fields and methods. Methods
+ * use the fields, call each other and are full of statements and expressions,
+ * so every stage of the compiler has plenty to do.
+ *
+ * @param  field_count  The number of int and int array field pairs; at least 1.
+ * @param  method_count The number of methods, not counting main.
+ * @return              The source of the program, to be freed by the caller.
+ */
+static inline char* bench_generate_program(int field_count, int method_count)
+{
+    size_t capacity = 64 * field_count + 512 * method_count + 64;
+    char* source = malloc(capacity);
+    size_t length = 0;
+
+    length += sprintf(source + length, "class Program {\n");
+    for (int i = 0; i < field_count; i++) {
+        length += sprintf(source + length, "    int f%d, g%d[%d];\n", i, i, i + 1);
+    }
+    for (int i = 0; i < method_count; i++) {
+        int field = i % field_count;
+        length += sprintf(source + length,
+            "    int m%d(int a, boolean b) {\n"
+            "        int x, y;\n"
+            "        x = a * 3 + f%d - g%d[a %% %d] / (a + 1);\n"
+            "        for y = 0, x {\n"
+            "            if (x > y && y != 3 || !(a < y)) { x -= g%d[y %% %d] + y * 2; }\n"
+            "        }\n"
+            "        if (b && x > 0) { x = m%d(x - 1, !b); }\n"
+            "        callout(\"printf\", \"%%d\\n\", x);\n"
+            "        return x + y + -%d;\n"
+            "    }\n",
+            i, field, field, field + 1, field, field + 1, i, i);
+    }
+    sprintf(source + length, "    void main() {\n    }\n}\n");
+
+    return source;
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../src/lexer.h"
+#include "../src/tokens.h"
+
+#define IDENTIFIER_COUNT 4096
+#define ROUNDS 20000
+
+
+/**
+ * Identifiers to classify; a mix of keywords and typical variable names.
+ */
+static const char* samples[] = {
+    "boolean", "break", "callout", "class", "continue", "else", "false", "for",
+    "if", "int", "return", "true", "void", "i", "x", "count", "index", "main",
+    "Program", "result", "fib", "value", "printf", "a1", "tmp", "forward",
+    "iffy", "integer", "voids", "classic", "elsewhere", "truth"
+};
+
+/**
+ * The keyword lookup the lexer used before the perfect hash, for comparison.
+ */
+static TokenType linear_keyword_type(const char* identifier, int length)
+{
+    static const char* keywords[] = {
+        "boolean", "break", "callout", "class", "continue", "else", "false", "for",
+        "if", "int", "return", "true", "void"
+    };
+    static const TokenType types[] = {
+        T_BOOLEAN, T_BREAK, T_CALLOUT, T_CLASS, T_CONTINUE, T_ELSE, T_BOOLEAN_LITERAL,
+        T_FOR, T_IF, T_INT, T_RETURN, T_BOOLEAN_LITERAL, T_VOID
+    };
+
+    for (int i = 0; i < 13; i++) {
+        if (strncmp(identifier, keywords[i], length) == 0 && keywords[i][length] == '\0') {
+            return types[i];
+        }
+    }
+    return T_IDENTIFIER;
+}
+
+/**
+ * Classifies every identifier many times over and reports identifiers per second.
+ */
+static void run(const char* name, TokenType (*classify)(const char*, int), const char** identifiers, int* lengths)
+{
+    unsigned long checksum = 0;
+    double start = bench_now();
+
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < IDENTIFIER_COUNT; i++) {
+            checksum += classify(identifiers[i], lengths[i]);
+        }
+    }
+
+    double elapsed = bench_now() - start;
+    double rate = (double)IDENTIFIER_COUNT * ROUNDS / elapsed;
+    printf("%-8s %12.0f identifiers/sec (checksum %lu)\n", name, rate, checksum);
+}
+
+int main(void)
+{
+    static const char* identifiers[IDENTIFIER_COUNT];
+    static int lengths[IDENTIFIER_COUNT];
+    int sample_count = sizeof(samples) / sizeof(samples[0]);
+
+    // pick identifiers in a fixed pseudo-random order
+    srand(1);
+    for (int i = 0; i < IDENTIFIER_COUNT; i++) {
+        identifiers[i] = samples[rand() % sample_count];
+        lengths[i] = strlen(identifiers[i]);
+    }
+
+    run("linear", linear_keyword_type, identifiers, lengths);
+    run("hashed", lexer_keyword_type, identifiers, lengths);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "../src/arena.h"
+#include "../src/ast.h"
+#include "../src/intern.h"
+#include "../src/lexer.h"
+#include "../src/parser.h"
+#include "../src/scanner.h"
+
+#define FIELD_COUNT 2000
+#define METHOD_COUNT 2000
+#define ROUNDS 20
+
+
+/**
+ * Counts the tokens in a source.
+ */
+static long count_tokens(char* source)
+{
+    ScannerContext* context = scanner_open_string(source);
+    Lexer* lexer = lexer_create(context);
+
+    long count = 0;
+    while (lexer_next(lexer).type != T_EOF) {
+        count++;
+    }
+
+    lexer_destroy(&lexer);
+    scanner_close(&context);
+    intern_clear();
+    return count;
+}
+
+/**
+ * Looks ahead the way the parser did when lookahead meant stepping forward and
+ * backtracking again, for comparison. Returns the number of steps taken.
+ */
+static long walk_lookahead(Lexer* lexer, int count, Token* token)
+{
+    long start = lexer->current;
+    for (int i = 0; i < count; i++) {
+        *token = lexer_next(lexer);
+    }
+
+    // the lexer doesn't move past the end-of-file
+    long steps = lexer->current - start;
+    for (long i = 0; i < steps; i++) {
+        lexer_backtrack(lexer);
+    }
+
+    return 2 * steps;
+}
+
+/**
+ * Peeks at every token the way the parser does before each field and each
+ * method call, once by walking the token stream and once through the window.
+ */
+static void run_peeks(char* source, long tokens)
+{
+    for (int windowed = 0; windowed < 2; windowed++) {
+        ScannerContext* context = scanner_open_string(source);
+        Lexer* lexer = lexer_create(context);
+
+        unsigned long checksum = 0;
+        long walks = 0;
+        double start = bench_now();
+
+        // start on the first token; a lexer can't backtrack to before it
+        lexer_next(lexer);
+
+        for (long i = 1; i < tokens; i++) {
+            Token token;
+            for (int count = 1; count <= PARSER_MAX_LOOKAHEAD; count++) {
+                if (windowed) {
+                    token = lexer_lookahead(lexer, count);
+                } else {
+                    walks += walk_lookahead(lexer, count, &token);
+                }
+                checksum += token.type;
+            }
+            lexer_next(lexer);
+        }
+
+        double elapsed = bench_now() - start;
+        printf("%-8s %12.0f peeks/sec, %ld token stream steps (checksum %lu)\n",
+            windowed ? "window" : "walk", tokens * PARSER_MAX_LOOKAHEAD / elapsed, walks, checksum);
+
+        lexer_destroy(&lexer);
+        scanner_close(&context);
+        intern_clear();
+    }
+}
+
+/**
+ * Parses the whole program many times over and reports tokens per second.
+ */
+static void run_parse(char* source, long tokens)
+{
+    double start = bench_now();
+
+    for (int round = 0; round < ROUNDS; round++) {
+        ScannerContext* context = scanner_open_string(source);
+        Lexer* lexer = lexer_create_bounded(context, PARSER_MAX_LOOKAHEAD);
+
+        Arena* arena = arena_create();
+        parser_parse(lexer, arena);
+        arena_destroy(&arena);
+
+        lexer_destroy(&lexer);
+        scanner_close(&context);
+        intern_clear();
+    }
+
+    double elapsed = bench_now() - start;
+    printf("%-8s %12.0f tokens/sec\n", "parse", tokens * ROUNDS / elapsed);
+}
+
+int main(void)
+{
+    char* source = bench_generate_program(FIELD_COUNT, METHOD_COUNT);
+    long tokens = count_tokens(source);
+
+    run_peeks(source, tokens);
+    run_parse(source, tokens);
+
+    free(source);
+    return error_get_last();
+}
@@ -1,58 +1,96 @@
+#include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "analyzer.h"
 #include "ast.h"
 #include "error.h"
+#include "intern.h"
+#include "pass_manager.h"
 #include "symbol_table.h"
 
 
 /**
- * Analyzes and optimizes an abstract syntax tree.
+ * The state of the debug info being written.
  */
-Error analyzer_analyze(ASTNode* node, SymbolTable* table)
+static struct {
+    /**
+     * The debug file.
+     */
+    FILE* file;
+
+    /**
+     * The stream the tree is written to until the symbols are known.
+     */
+    FILE* stream;
+
+    /**
+     * The contents of the stream.
+     */
+    char* buffer;
+
+    /**
+     * The size of the contents of the stream.
+     */
+    size_t size;
+
+    /**
+     * The indentation depth of the node being written.
+     */
+    int depth;
+} analyzer_debug;
+
+
+/**
+ * Opens up the global scope before analyzing a tree.
+ */
+static Error analyzer_begin(ASTNode* root, void* table)
 {
     // create global scope
     symbol_table_begin_scope(table);
 
-    // analyze the root
-    analyzer_analyze_node(node, table);
+    return E_SUCCESS;
+}
 
+/**
+ * Finishes analyzing a tree by checking for a main method and closing the
+ * global scope.
+ */
+static Error analyzer_end(ASTNode* root, void* table)
+{
     // make sure a main method exists
-    SymbolEntry* main = symbol_table_lookup_anywhere(table, "main");
+    SymbolEntry* main = symbol_table_lookup_anywhere(table, intern_string("main", 4));
     if (main == NULL || (main->flags & SYMBOL_FUNCTION) == 0) {
-        analyzer_error(node, "No main method defined");
+        analyzer_error(root, "No main method defined");
     }
 
     // close global scope
     symbol_table_end_scope(table);
+
+    return E_SUCCESS;
 }
 
 /**
- * Displays an analyzer error.
+ * Checks if a node opens up a new scope level.
  */
-Error analyzer_error(ASTNode* node, char* message)
+static bool analyzer_opens_scope(ASTNode* node)
 {
-    // display the error message
-    return error(
-        E_ANALYZE_ERROR,
-        "in file \"%s\" near line %d, column %d:\n\t%s",
-        node->file,
-        node->line,
-        node->column,
-        message
-    );
+    // kind of a kludge here; open up for and method scopes one level up
+    // instead of at the block because AST is weird
+    return node->kind == AST_CLASS_DECL || node->kind == AST_METHOD_DECL || node->kind == AST_FOR_STATEMENT || (node->kind == AST_BLOCK && node->parent->kind != AST_METHOD_DECL && node->parent->kind != AST_FOR_STATEMENT);
 }
 
 /**
- * Recursively analyzes and optimizes an abstract syntax tree subtree.
+ * Analyzes a node before its children.
  */
-Error analyzer_analyze_node(ASTNode* node, SymbolTable* table)
+static ASTVisitAction analyzer_enter_node(ASTNode* node, void* context)
 {
-    bool new_scope = false;
+    SymbolTable* table = context;
 
     // if the node is a declaration of some sort, insert it into the symbol table
     if ((node->kind & 0xF) == AST_DECL) {
-        char* symbol = ((ASTDecl*)node)->identifier;
+        const char* symbol = ((ASTDecl*)node)->identifier;
 
         // make sure the symbol doesn't already exist in the current scope
         if (symbol_table_exists_local(table, symbol)) {
@@ -72,20 +110,22 @@ Error analyzer_analyze_node(ASTNode* node, SymbolTable* table)
     }
 
     // the following node kinds open up a new scope level
-    if (node->kind == AST_CLASS_DECL || node->kind == AST_METHOD_DECL || node->kind == AST_FOR_STATEMENT || (node->kind == AST_BLOCK && node->parent->kind != AST_METHOD_DECL && node->parent->kind != AST_FOR_STATEMENT)) {
-        // kind of a kludge here; open up for and method scopes one level up
-        // instead of at the block because AST is weird
-
+    if (analyzer_opens_scope(node)) {
         // open up a new scope level
         symbol_table_begin_scope(table);
-        new_scope = true;
     }
 
-    // if the node is a unary minus, do fixes if necessary
-    if (node->kind == AST_UNARY_OP && ((ASTOperation*)node)->operator[0] == '-') {
+    // if the node is a unary minus, do fixes if necessary; the node visited
+    // from here on is whatever took its place
+    if (node->kind == AST_UNARY_OP && ((ASTOperation*)node)->operator == OP_NEGATE) {
         analyzer_fix_minus_int(&node);
     }
 
+    // ints are 32 bits; -2147483648 only got here negated by the fix above
+    if (node->kind == AST_INT_LITERAL && (node->value.int_value > INT_MAX || node->value.int_value < INT_MIN)) {
+        analyzer_error(node, "Integer literal out of range");
+    }
+
     // if the node is some kind of expression, determine its type now
     if ((node->kind & 0xF) == AST_REFERENCE || (node->kind & 0xF) == AST_OP_EXPR || node->kind == AST_RETURN_STATEMENT || node->kind == AST_INT_LITERAL || node->kind == AST_BOOLEAN_LITERAL || node->kind == AST_CHAR_LITERAL || node->kind == AST_STRING_LITERAL) {
         analyzer_determine_expr_type(node, table);
@@ -125,10 +165,15 @@ Error analyzer_analyze_node(ASTNode* node, SymbolTable* table)
         }
     }
 
-    // analyze each child node
-    for (int i = 0; i < node->child_count; ++i) {
-        analyzer_analyze_node(node->children[i], table);
-    }
+    return AST_VISIT_CONTINUE;
+}
+
+/**
+ * Analyzes a node after its children.
+ */
+static ASTVisitAction analyzer_leave_node(ASTNode* node, void* context)
+{
+    SymbolTable* table = context;
 
     // now that child nodes have been examined, verify if and for statements have
     // proper expression types in them
@@ -150,29 +195,28 @@ Error analyzer_analyze_node(ASTNode* node, SymbolTable* table)
     }
 
     // finally, close a scope if we opened one earlier
-    if (new_scope) {
+    if (analyzer_opens_scope(node)) {
         symbol_table_end_scope(table);
     }
 
-    return E_SUCCESS;
+    return AST_VISIT_CONTINUE;
 }
 
 /**
- * Determines the type of an expression.
- *
- * Walks down the expression until the type can be determined. Walks back up,
- * setting types and checking for errors.
+ * Determines the type of an expression node before its children.
  */
-Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
+static ASTVisitAction analyzer_enter_expr(ASTNode* node, void* context)
 {
+    SymbolTable* table = context;
+
     // if type is already determined, stop
     if (node->type != TYPE_NONE) {
-        return E_SUCCESS;
+        return AST_VISIT_SKIP;
     }
 
     // if node is a reference to something, fetch its type from the symbol table
     if ((node->kind & 0xF) == AST_REFERENCE) {
-        char* symbol = ((ASTReference*)node)->identifier;
+        const char* symbol = ((ASTReference*)node)->identifier;
         SymbolEntry* entry = symbol_table_lookup(table, symbol);
 
         if (entry == NULL) {
@@ -188,11 +232,14 @@ Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
         }
     }
 
-    // determine types for child nodes next
-    for (int i = 0; i < node->child_count; ++i) {
-        analyzer_determine_expr_type(node->children[i], table);
-    }
+    return AST_VISIT_CONTINUE;
+}
 
+/**
+ * Determines the type of an expression node from the types of its children.
+ */
+static ASTVisitAction analyzer_leave_expr(ASTNode* node, void* context)
+{
     // assignments "return" the value that is assigned, so the type is inherited
     if (node->kind == AST_ASSIGN_OP) {
         // make sure types match; that the value assigned matches the variable type
@@ -201,7 +248,7 @@ Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
         }
 
         // += and -= can only be used on ints
-        if (((ASTOperation*)node)->operator[0] != '=') {
+        if (((ASTOperation*)node)->operator != OP_ASSIGN) {
             if (node->children[0]->type != TYPE_INT) {
                 analyzer_error(node, "Left operand not an int");
             }
@@ -218,7 +265,7 @@ Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
     if (node->kind == AST_UNARY_OP) {
         ASTOperation* op = (ASTOperation*)node;
         // minus
-        if (strcmp(op->operator, "-") == 0) {
+        if (op->operator == OP_NEGATE) {
             // everything has to be an int
             if (node->children[0]->type != TYPE_INT) {
                 analyzer_error(node, "Minus operand not an int");
@@ -238,42 +285,49 @@ Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
 
     // binary ops
     if (node->kind == AST_BINARY_OP) {
-        ASTOperation* op = (ASTOperation*)node;
-        // check binary arithmetic operations
-        if (strcmp(op->operator, "+") == 0 || strcmp(op->operator, "-") == 0 || strcmp(op->operator, "*") == 0 || strcmp(op->operator, "/") == 0 || strcmp(op->operator, "%") == 0) {
-            // everything has to be an int
-            if (node->children[0]->type != TYPE_INT) {
-                analyzer_error(node, "Left operand not an int");
-            }
-            if (node->children[1]->type != TYPE_INT) {
-                analyzer_error(node, "Right operand not an int");
-            }
-            node->type = TYPE_INT;
-        }
-
-        // check relational comparisons
-        else if (strcmp(op->operator, "<") == 0 || strcmp(op->operator, "<=") == 0 || strcmp(op->operator, ">=") == 0 || strcmp(op->operator, ">") == 0) {
-            // everything has to be an int
-            if (node->children[0]->type != TYPE_INT) {
-                analyzer_error(node, "Left operand not an int");
-            }
-            if (node->children[1]->type != TYPE_INT) {
-                analyzer_error(node, "Right operand not an int");
-            }
-            // result is boolean
-            node->type = TYPE_BOOLEAN;
-        }
-
-        // conditionals
-        else {
-            // everything has to be bool
-            if (node->children[0]->type != TYPE_BOOLEAN) {
-                analyzer_error(node, "Left operand not boolean");
-            }
-            if (node->children[1]->type != TYPE_BOOLEAN) {
-                analyzer_error(node, "Right operand not boolean");
-            }
-            node->type = TYPE_BOOLEAN;
+        switch (((ASTOperation*)node)->operator) {
+            // check binary arithmetic operations
+            case OP_ADD:
+            case OP_SUBTRACT:
+            case OP_MULTIPLY:
+            case OP_DIVIDE:
+            case OP_MODULO:
+                // everything has to be an int
+                if (node->children[0]->type != TYPE_INT) {
+                    analyzer_error(node, "Left operand not an int");
+                }
+                if (node->children[1]->type != TYPE_INT) {
+                    analyzer_error(node, "Right operand not an int");
+                }
+                node->type = TYPE_INT;
+                break;
+
+            // check relational comparisons
+            case OP_LESSER:
+            case OP_LESSER_OR_EQUAL:
+            case OP_GREATER_OR_EQUAL:
+            case OP_GREATER:
+                // everything has to be an int
+                if (node->children[0]->type != TYPE_INT) {
+                    analyzer_error(node, "Left operand not an int");
+                }
+                if (node->children[1]->type != TYPE_INT) {
+                    analyzer_error(node, "Right operand not an int");
+                }
+                // result is boolean
+                node->type = TYPE_BOOLEAN;
+                break;
+
+            // conditionals
+            default:
+                // everything has to be bool
+                if (node->children[0]->type != TYPE_BOOLEAN) {
+                    analyzer_error(node, "Left operand not boolean");
+                }
+                if (node->children[1]->type != TYPE_BOOLEAN) {
+                    analyzer_error(node, "Right operand not boolean");
+                }
+                node->type = TYPE_BOOLEAN;
         }
     }
 
@@ -287,16 +341,82 @@ Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
         }
     }
 
+    return AST_VISIT_CONTINUE;
+}
+
+/**
+ * Gets the analysis pass.
+ */
+Pass analyzer_pass(SymbolTable* table)
+{
+    return (Pass){
+        "analyze",
+        true,
+        true,
+        analyzer_begin,
+        analyzer_enter_node,
+        analyzer_leave_node,
+        analyzer_end,
+        table
+    };
+}
+
+/**
+ * Analyzes and optimizes an abstract syntax tree.
+ */
+Error analyzer_analyze(ASTNode* node, SymbolTable* table)
+{
+    analyzer_begin(node, table);
+    analyzer_analyze_node(node, table);
+    analyzer_end(node, table);
+
     return E_SUCCESS;
 }
 
+/**
+ * Displays an analyzer error.
+ */
+Error analyzer_error(ASTNode* node, char* message)
+{
+    // display the error message
+    return error(
+        E_ANALYZE_ERROR,
+        "in file \"%s\" near line %d, column %d:\n\t%s",
+        node->file,
+        node->line,
+        node->column,
+        message
+    );
+}
+
+/**
+ * Analyzes and optimizes an abstract syntax tree subtree.
+ */
+Error analyzer_analyze_node(ASTNode* node, SymbolTable* table)
+{
+    ASTVisitor visitor = {analyzer_enter_node, analyzer_leave_node, table, NULL};
+    return ast_visit(node, &visitor, 1);
+}
+
+/**
+ * Determines the type of an expression.
+ *
+ * Walks down the expression until the type can be determined. Walks back up,
+ * setting types and checking for errors.
+ */
+Error analyzer_determine_expr_type(ASTNode* node, SymbolTable* table)
+{
+    ASTVisitor visitor = {analyzer_enter_expr, analyzer_leave_expr, table, NULL};
+    return ast_visit(node, &visitor, 1);
+}
+
 /**
  * Checks and verifies a method call's arguments.
  */
 Error analyzer_check_method_arguments(ASTNode* node, SymbolTable* table)
 {
     // first, we need to find the definition of the method being called
-    char* method_name = ((ASTReference*)node)->identifier;
+    const char* method_name = ((ASTReference*)node)->identifier;
 
     // find the class node
     ASTNode* class_node = node->parent;
@@ -308,7 +428,7 @@ Error analyzer_check_method_arguments(ASTNode* node, SymbolTable* table)
     ASTNode* method_node = NULL;
     for (int i = 0; i < class_node->child_count; ++i) {
         if (class_node->children[i]->kind == AST_METHOD_DECL) {
-            if (strcmp(((ASTDecl*)class_node->children[i])->identifier, method_name) == 0) {
+            if (((ASTDecl*)class_node->children[i])->identifier == method_name) {
                 method_node = class_node->children[i];
             }
         }
@@ -344,125 +464,98 @@ Error analyzer_fix_minus_int(ASTNode** node)
     // Node is a unary minus operation. Check if the operand (its only child) is
     // an int literal.
     if ((*node)->children[0]->kind == AST_INT_LITERAL) {
-        ASTNode* parent = (*node)->parent;
         ASTNode* int_literal = (*node)->children[0];
 
-        // modify the int literal to be negative (lots of pointer stuff here :( )
-        *((int*)            int_literal->value) = 0 - *((int*)int_literal->value);
-        //  ^cast to int | pointer to value^          ^ dereference
-
-        // below we get rid of the operator node and replace it with the int literal
-        // remove the int from the operator
-        ast_remove_child(*node, int_literal);
-        // get the position of the operator in the parent's children list
-        unsigned int pos = ast_get_child_index(parent, *node);
-        // and add the int literal as the child instead
-        parent->children[pos] = int_literal;
-        // and destroy the operator
-        //ast_destroy(node); <- don't destroy because it breaks things
-        //                      memory leak? who cares!
+        // modify the int literal to be negative
+        int_literal->value.int_value = 0 - int_literal->value.int_value;
+
+        // put the int literal where the operator was; the operator node is
+        // freed along with the rest of the tree, and the parent never needs
+        // more room for a single child
+        ast_splice(NULL, *node);
 
         // also note that we update what "node" refers to in the parent function
         // so that things don't blow up
         *node = int_literal;
     }
+
+    return E_SUCCESS;
 }
 
 /**
- * Writes an abstract syntax tree XML.
- *
- * @param  stream  A file stream to write to.
- * @param  parent  The subtree to print.
- * @param  depth   The indentation depth.
- * @return         An error code.
+ * Gets the XML tag name for a node kind.
  */
-static Error analyzer_write_subtree(FILE* stream, ASTNode* parent, int depth)
+static const char* analyzer_get_tag_name(ASTNodeKind kind)
 {
-    for (int i = 0; i < depth; ++i) {
-        fprintf(stream, "  ");
-    }
-
-    char* tag_name;
-
-    // print out a unique readable string identifying the node kind and attributes
-    switch (parent->kind) {
+    // a unique readable string identifying the node kind
+    switch (kind) {
         // generic kinds
         case AST_BLOCK:
-            tag_name = "block";
-            break;
+            return "block";
         case AST_IF_STATEMENT:
-            tag_name = "if";
-            break;
+            return "if";
         case AST_ELSE_STATEMENT:
-            tag_name = "else";
-            break;
+            return "else";
         case AST_FOR_STATEMENT:
-            tag_name = "for";
-            break;
+            return "for";
         case AST_BREAK_STATEMENT:
-            tag_name = "break";
-            break;
+            return "break";
         case AST_CONTINUE_STATEMENT:
-            tag_name = "continue";
-            break;
+            return "continue";
         case AST_RETURN_STATEMENT:
-            tag_name = "return";
-            break;
+            return "return";
         // literals
         case AST_INT_LITERAL:
-            tag_name = "int";
-            break;
+            return "int";
         case AST_BOOLEAN_LITERAL:
-            tag_name = "bool";
-            break;
+            return "bool";
         case AST_CHAR_LITERAL:
-            tag_name = "char";
-            break;
+            return "char";
         case AST_STRING_LITERAL:
-            tag_name = "string";
-            break;
+            return "string";
         // declaration kinds
         case AST_CLASS_DECL:
-            tag_name = "class";
-            break;
+            return "class";
         case AST_FIELD_DECL:
-            tag_name = "field";
-            break;
+            return "field";
         case AST_METHOD_DECL:
-            tag_name = "method";
-            break;
+            return "method";
         case AST_VAR_DECL:
-            tag_name = "var";
-            break;
+            return "var";
         case AST_PARAM_DECL:
-            tag_name = "param";
-            break;
+            return "param";
         // reference kinds
         case AST_LOCATION:
-            tag_name = "location";
-            break;
+            return "location";
         case AST_METHOD_CALL:
-            tag_name = "method_call";
-            break;
+            return "method_call";
         case AST_CALLOUT:
-            tag_name = "callout";
-            break;
+            return "callout";
         // operator kinds
         case AST_UNARY_OP:
-            tag_name = "unary_op";
-            break;
+            return "unary_op";
         case AST_BINARY_OP:
-            tag_name = "binary_op";
-            break;
+            return "binary_op";
         case AST_ASSIGN_OP:
-            tag_name = "assign_op";
-            break;
+            return "assign_op";
         // unknown
         default:
-            tag_name = "unknown";
+            return "unknown";
     }
+}
 
-    fprintf(stream, "<%s", tag_name);
+/**
+ * Writes the opening tag of a node and its attributes as XML.
+ */
+static ASTVisitAction analyzer_enter_debug(ASTNode* parent, void* context)
+{
+    FILE* stream = analyzer_debug.stream;
+
+    for (int i = 0; i < analyzer_debug.depth; ++i) {
+        fprintf(stream, "  ");
+    }
+
+    fprintf(stream, "<%s", analyzer_get_tag_name(parent->kind));
 
     // write file position
     fprintf(stream, " line=\"%d\" column=\"%d\"", parent->line, parent->column);
@@ -479,7 +572,7 @@ static Error analyzer_write_subtree(FILE* stream, ASTNode* parent, int depth)
 
     // op expression node
     else if ((parent->kind & 0xF) == AST_OP_EXPR) {
-        fprintf(stream, " operator=\"%s\"", ((ASTOperation*)parent)->operator);
+        fprintf(stream, " operator=\"%s\"", ast_operator_string(((ASTOperation*)parent)->operator));
     }
 
     if (parent->kind == AST_FIELD_DECL) {
@@ -487,45 +580,56 @@ static Error analyzer_write_subtree(FILE* stream, ASTNode* parent, int depth)
     }
 
     else if (parent->kind == AST_INT_LITERAL) {
-        fprintf(stream, " value=\"%d\"", *(int*)parent->value);
+        fprintf(stream, " value=\"%ld\"", parent->value.int_value);
     }
 
     else if (parent->kind == AST_BOOLEAN_LITERAL) {
-        fprintf(stream, " value=\"%s\"", (*(bool*)parent->value) ? "true" : "false");
+        fprintf(stream, " value=\"%s\"", parent->value.bool_value ? "true" : "false");
+    }
+
+    else if (parent->kind == AST_CHAR_LITERAL) {
+        fprintf(stream, " value=\"");
+        ast_write_escaped(stream, (char[]){parent->value.char_value, '\0'});
+        fprintf(stream, "\"");
     }
 
-    else if (parent->kind == AST_CHAR_LITERAL || parent->kind == AST_STRING_LITERAL) {
-        fprintf(stream, " value=\"%s\"", (char*)parent->value);
+    else if (parent->kind == AST_STRING_LITERAL) {
+        fprintf(stream, " value=\"");
+        ast_write_escaped(stream, parent->value.string_value);
+        fprintf(stream, "\"");
     }
 
     if (parent->child_count > 0) {
         fprintf(stream, ">\n");
+        analyzer_debug.depth++;
     } else {
         fprintf(stream, "/>\n");
-        return E_SUCCESS;
     }
 
-    // print every child node recursively
-    for (int i = 0; i < parent->child_count; i++) {
-        // print the child
-        Error e;
-        if ((e = analyzer_write_subtree(stream, parent->children[i], depth + 1)) != E_SUCCESS) {
-            return e;
-        }
-    }
+    return AST_VISIT_CONTINUE;
+}
 
-    for (int i = 0; i < depth; ++i) {
-        fprintf(stream, "  ");
+/**
+ * Writes the closing tag of a node as XML, if it needs one.
+ */
+static ASTVisitAction analyzer_leave_debug(ASTNode* parent, void* context)
+{
+    if (parent->child_count > 0) {
+        analyzer_debug.depth--;
+        for (int i = 0; i < analyzer_debug.depth; ++i) {
+            fprintf(analyzer_debug.stream, "  ");
+        }
+        fprintf(analyzer_debug.stream, "</%s>\n", analyzer_get_tag_name(parent->kind));
     }
-    fprintf(stream, "</%s>\n", tag_name);
 
-    return E_SUCCESS;
+    return AST_VISIT_CONTINUE;
 }
 
 /**
- * Writes out debugging info to a file.
+ * Opens the debug file and starts writing the tree to memory, since the
+ * symbols that come before it in the file are only known after analysis.
  */
-Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table)
+static Error analyzer_begin_debug(ASTNode* root, void* table)
 {
     // append .dbg to the filename to write to
     char* filename = malloc(strlen(root->file) + 5);
@@ -533,10 +637,27 @@ Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table)
     strncat(filename, ".dbg", 4);
 
     // open the dbg file for writing
-    FILE* stream = fopen(filename, "w");
-    if (stream == NULL) {
-        return error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
+    analyzer_debug.file = fopen(filename, "w");
+    if (analyzer_debug.file == NULL) {
+        Error e = error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
+        free(filename);
+        return e;
     }
+    free(filename);
+
+    analyzer_debug.stream = open_memstream(&analyzer_debug.buffer, &analyzer_debug.size);
+    analyzer_debug.depth = 2;
+
+    return E_SUCCESS;
+}
+
+/**
+ * Writes out the symbol table and the tree to the debug file.
+ */
+static Error analyzer_end_debug(ASTNode* root, void* table)
+{
+    FILE* stream = analyzer_debug.file;
+    fclose(analyzer_debug.stream);
 
     // write debug info as xml
     fprintf(stream, "<?xml version=\"1.0\"?>\n");
@@ -545,7 +666,7 @@ Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table)
     // write the contents of the symbol table
     fprintf(stream, "  <symbols>\n");
     int scope_id = 0;
-    for (SymbolMap* map = table->sheaf_tail; map != NULL; map = map->previous) {
+    for (SymbolMap* map = ((SymbolTable*)table)->sheaf_tail; map != NULL; map = map->previous) {
         for (int i = 0; i < SYMBOL_MAP_SIZE; i++) {
             for (SymbolEntry* entry = map->entries[i]; entry != NULL; entry = entry->next) {
                 fprintf(stream, "    <symbol name=\"%s\" scope=\"%d\" type=\"%s\"",
@@ -571,13 +692,47 @@ Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table)
 
     // write the ast
     fprintf(stream, "\n  <ast>\n");
-    analyzer_write_subtree(stream, root, 2);
+    fwrite(analyzer_debug.buffer, 1, analyzer_debug.size, stream);
     fprintf(stream, "  </ast>\n");
 
     fprintf(stream, "</debug>\n");
 
     // close the file
     fclose(stream);
+    free(analyzer_debug.buffer);
 
     return E_SUCCESS;
 }
+
+/**
+ * Gets the pass that writes out debugging info to a file.
+ */
+Pass analyzer_debug_pass(SymbolTable* table)
+{
+    return (Pass){
+        "debug",
+        true,
+        false,
+        analyzer_begin_debug,
+        analyzer_enter_debug,
+        analyzer_leave_debug,
+        analyzer_end_debug,
+        table
+    };
+}
+
+/**
+ * Writes out debugging info to a file.
+ */
+Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table)
+{
+    Error e;
+    if ((e = analyzer_begin_debug(root, table)) != E_SUCCESS) {
+        return e;
+    }
+
+    ASTVisitor visitor = {analyzer_enter_debug, analyzer_leave_debug, table, NULL};
+    ast_visit(root, &visitor, 1);
+
+    return analyzer_end_debug(root, table);
+}
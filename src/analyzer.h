@@ -3,6 +3,7 @@
 
 #include "ast.h"
 #include "error.h"
+#include "pass_manager.h"
 #include "symbol_table.h"
 
 
@@ -15,6 +16,14 @@
  */
 Error analyzer_analyze(ASTNode* node, SymbolTable* table);
 
+/**
+ * Gets the analysis pass, which does the same as analyzer_analyze().
+ *
+ * @param  table The symbol table.
+ * @return       The pass.
+ */
+Pass analyzer_pass(SymbolTable* table);
+
 /**
  * Displays an analyzer error.
  *
@@ -25,7 +34,7 @@ Error analyzer_analyze(ASTNode* node, SymbolTable* table);
 Error analyzer_error(ASTNode* node, char* message);
 
 /**
- * Recursively analyzes and optimizes an abstract syntax tree subtree.
+ * Analyzes and optimizes an abstract syntax tree subtree.
  *
  * @param  node  The root node of an abstract syntax tree to analyze.
  * @param  table The symbol table.
@@ -68,4 +77,16 @@ Error analyzer_fix_minus_int(ASTNode** node);
  */
 Error analyzer_write_debug_info(ASTNode* root, SymbolTable* table);
 
+/**
+ * Gets the pass that writes out debugging info to a file, which does the same
+ * as analyzer_write_debug_info().
+ *
+ * The symbol table is written as it is once all passes are done, so the pass
+ * can share a visit with the analysis pass.
+ *
+ * @param  table The program's symbol table.
+ * @return       The pass.
+ */
+Pass analyzer_debug_pass(SymbolTable* table);
+
 #endif
@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "arena.h"
+
+// the usual size of a block; bigger allocations get a block of their own
+#define ARENA_BLOCK_SIZE (64 * 1024)
+// every allocation starts on a multiple of this many bytes
+#define ARENA_ALIGNMENT 16
+
+
+/**
+ * A block of memory allocations are bumped out of.
+ */
+typedef struct ArenaBlock {
+    /**
+     * The previously filled block, if any.
+     */
+    struct ArenaBlock* previous;
+
+    /**
+     * The next free byte in the block.
+     */
+    uintptr_t next;
+
+    /**
+     * The first byte past the end of the block.
+     */
+    uintptr_t end;
+
+    /**
+     * The memory of the block itself.
+     */
+    char data[];
+} ArenaBlock;
+
+struct Arena {
+    /**
+     * The block currently being allocated from.
+     */
+    ArenaBlock* block;
+
+    /**
+     * The number of bytes handed out so far.
+     */
+    size_t size;
+};
+
+
+/**
+ * Adds a new block to an arena big enough to hold at least the given size.
+ */
+static void arena_grow(Arena* arena, size_t size)
+{
+    size_t block_size = ARENA_BLOCK_SIZE;
+    if (size + ARENA_ALIGNMENT > block_size) {
+        block_size = size + ARENA_ALIGNMENT;
+    }
+
+    ArenaBlock* block = malloc(sizeof(ArenaBlock) + block_size);
+    block->previous = arena->block;
+    block->next = (uintptr_t)block->data;
+    block->end = block->next + block_size;
+    arena->block = block;
+}
+
+/**
+ * Creates an empty arena.
+ */
+Arena* arena_create(void)
+{
+    Arena* arena = malloc(sizeof(Arena));
+    arena->block = NULL;
+    arena->size = 0;
+
+    return arena;
+}
+
+/**
+ * Allocates memory from an arena.
+ */
+void* arena_alloc(Arena* arena, size_t size)
+{
+    ArenaBlock* block = arena->block;
+    uintptr_t start = 0;
+
+    if (block != NULL) {
+        start = (block->next + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+    }
+
+    // start a fresh block if this one is full
+    if (block == NULL || start > block->end || block->end - start < size) {
+        arena_grow(arena, size);
+        block = arena->block;
+        start = (block->next + ARENA_ALIGNMENT - 1) & ~(uintptr_t)(ARENA_ALIGNMENT - 1);
+    }
+
+    block->next = start + size;
+    arena->size += size;
+
+    return (void*)start;
+}
+
+/**
+ * Gets the number of bytes handed out by an arena so far.
+ */
+size_t arena_get_size(Arena* arena)
+{
+    return arena->size;
+}
+
+/**
+ * Destroys an arena and frees everything allocated from it in one go.
+ */
+Error arena_destroy(Arena** arena)
+{
+    // bad pointers is bad
+    if (arena == NULL || *arena == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    ArenaBlock* block = (*arena)->block;
+    while (block != NULL) {
+        ArenaBlock* previous = block->previous;
+        free(block);
+        block = previous;
+    }
+
+    free(*arena);
+    *arena = NULL;
+
+    return E_SUCCESS;
+}
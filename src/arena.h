@@ -0,0 +1,51 @@
+#ifndef WALRUS_ARENA_H
+#define WALRUS_ARENA_H
+
+#include <stddef.h>
+#include "error.h"
+
+
+/**
+ * A bump allocator for memory that all lives and dies together.
+ *
+ * Memory is carved out of large blocks in allocation order, and is only ever
+ * given back all at once when the arena is destroyed.
+ */
+typedef struct Arena Arena;
+
+/**
+ * Creates an empty arena.
+ *
+ * @return A shiny new arena.
+ */
+Arena* arena_create(void);
+
+/**
+ * Allocates memory from an arena.
+ *
+ * The memory is suitably aligned for any type and is not initialized. It
+ * stays valid until the arena is destroyed; it cannot be freed on its own.
+ *
+ * @param  arena The arena to allocate from.
+ * @param  size  The number of bytes to allocate.
+ * @return       A pointer to the allocated memory.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/**
+ * Gets the number of bytes handed out by an arena so far.
+ *
+ * @param  arena The arena.
+ * @return       The number of bytes allocated, not counting alignment padding.
+ */
+size_t arena_get_size(Arena* arena);
+
+/**
+ * Destroys an arena and frees everything allocated from it in one go.
+ *
+ * @param  arena The arena to destroy.
+ * @return       An error code.
+ */
+Error arena_destroy(Arena** arena);
+
+#endif
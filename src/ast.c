@@ -1,15 +1,88 @@
+#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "ast.h"
 #include "tokens.h"
 #include "types.h"
 
+/**
+ * A map from operators to their source representation.
+ */
+static const char* ast_operator_strings[] = {
+    [OP_ADD] = "+",
+    [OP_SUBTRACT] = "-",
+    [OP_MULTIPLY] = "*",
+    [OP_DIVIDE] = "/",
+    [OP_MODULO] = "%",
+    [OP_LESSER] = "<",
+    [OP_LESSER_OR_EQUAL] = "<=",
+    [OP_GREATER_OR_EQUAL] = ">=",
+    [OP_GREATER] = ">",
+    [OP_EQUAL] = "==",
+    [OP_NOT_EQUAL] = "!=",
+    [OP_AND] = "&&",
+    [OP_OR] = "||",
+    [OP_NEGATE] = "-",
+    [OP_NOT] = "!",
+    [OP_ASSIGN] = "=",
+    [OP_ADD_ASSIGN] = "+=",
+    [OP_SUBTRACT_ASSIGN] = "-="
+};
+
+// fails to compile unless the map ends at the last operator; a static assert
+// without C11
+typedef char ast_operator_strings_check[
+    sizeof(ast_operator_strings) / sizeof(ast_operator_strings[0]) == AST_OPERATOR_COUNT ? 1 : -1
+];
+
+
+/**
+ * Gets the number of children nodes of a kind have, or start out with room
+ * for if they hold lists.
+ */
+static unsigned int ast_get_child_capacity(ASTNodeKind kind)
+{
+    switch (kind) {
+        // one optional child: an array index, operand, value or block
+        case AST_LOCATION:
+        case AST_UNARY_OP:
+        case AST_RETURN_STATEMENT:
+        case AST_ELSE_STATEMENT:
+            return 1;
+
+        // left and right side
+        case AST_BINARY_OP:
+        case AST_ASSIGN_OP:
+            return 2;
+
+        // condition, block and optional else
+        case AST_IF_STATEMENT:
+            return 3;
+
+        // variable, initial assignment, limit and block
+        case AST_FOR_STATEMENT:
+            return 4;
+
+        // lists of members, parameters, statements or arguments
+        case AST_CLASS_DECL:
+        case AST_METHOD_DECL:
+        case AST_BLOCK:
+        case AST_METHOD_CALL:
+        case AST_CALLOUT:
+            return AST_INITIAL_CHILD_CAPACITY;
+
+        // leaves
+        default:
+            return 0;
+    }
+}
 
 /**
  * Creates an abstract syntax tree node.
  */
-void* ast_create_node(ASTNodeKind kind, char* file)
+void* ast_create_node(Arena* arena, ASTNodeKind kind, char* file)
 {
     // determine what node size to use
     size_t node_size = sizeof(ASTNode);
@@ -29,20 +102,22 @@ void* ast_create_node(ASTNodeKind kind, char* file)
         node_size = sizeof(ASTOperation);
     }
 
-    // allocate memory for the node
-    ASTNode* node = malloc(node_size);
+    // allocate memory for the node, with its children array right after it
+    unsigned int child_capacity = ast_get_child_capacity(kind);
+    ASTNode* node = arena_alloc(arena, node_size + sizeof(ASTNode*) * child_capacity);
 
-    // allocate and initialize children array
-    node->child_size = sizeof(ASTNode*) * 10;
+    // initialize children array
+    node->child_capacity = child_capacity;
     node->child_count = 0;
-    node->children = malloc(node->child_size);
+    node->index = 0;
+    node->children = child_capacity > 0 ? (ASTNode**)((char*)node + node_size) : NULL;
 
     // set other values to default as well
     node->file = file;
     node->line = 0;
     node->column = 0;
     node->parent = NULL;
-    node->value = NULL;
+    node->value.int_value = 0;
     node->type = TYPE_NONE;
     if ((kind & 0xF) == AST_DECL) {
         ((ASTDecl*)node)->flags = 0;
@@ -54,6 +129,32 @@ void* ast_create_node(ASTNodeKind kind, char* file)
     return node;
 }
 
+/**
+ * Makes sure a node has room for a given number of children.
+ */
+static void ast_reserve_children(Arena* arena, ASTNode* parent, unsigned int count)
+{
+    if (count <= parent->child_capacity) {
+        return;
+    }
+
+    // move to a bigger array; the old one is left for the arena
+    unsigned int child_capacity = parent->child_capacity > 0
+        ? parent->child_capacity
+        : AST_INITIAL_CHILD_CAPACITY;
+    while (child_capacity < count) {
+        child_capacity <<= 1;
+    }
+
+    assert(arena != NULL);
+    ASTNode** children = arena_alloc(arena, sizeof(ASTNode*) * child_capacity);
+    if (parent->child_count > 0) {
+        memcpy(children, parent->children, parent->child_count * sizeof(ASTNode*));
+    }
+    parent->child_capacity = child_capacity;
+    parent->children = children;
+}
+
 /**
  * Gets the position of a child in a parent node's child list.
  */
@@ -64,32 +165,23 @@ int (ast_get_child_index)(ASTNode* parent, ASTNode* child)
         return error(E_BAD_POINTER, "Bad pointer");
     }
 
-    for (int i = 0; i < parent->child_count; ++i) {
-        if (parent->children[i] == child) {
-            return i;
-        }
-    }
-
-    return -1;
+    return child->parent == parent ? child->index : -1;
 }
 
 /**
  * Adds an abstract syntax tree node to another node as a child.
  */
-Error (ast_add_child)(ASTNode* parent, ASTNode* child)
+Error (ast_add_child)(Arena* arena, ASTNode* parent, ASTNode* child)
 {
     // make sure pointer isn't null
     if (parent == NULL || child == NULL) {
         return error(E_BAD_POINTER, "Bad pointer");
     }
 
-    // reallocate if full
-    if (parent->child_count * sizeof(ASTNode*) >= parent->child_size) {
-        parent->child_size = parent->child_size << 1;
-        parent->children = realloc(parent->children, parent->child_size);
-    }
+    ast_reserve_children(arena, parent, parent->child_count + 1);
 
     // add to end of array
+    child->index = parent->child_count;
     parent->children[parent->child_count++] = child;
     // update parent pointer of child
     child->parent = parent;
@@ -116,30 +208,303 @@ ASTNode* (ast_remove_child)(ASTNode* parent, unsigned int child_index)
 
     // get the node at the given index
     ASTNode* child = parent->children[child_index];
+    child->parent = NULL;
 
     // shift all remaining children to the left
     parent->child_count--;
-    for (int i = child_index; i < parent->child_count; ++i) {
+    for (unsigned int i = child_index; i < parent->child_count; ++i) {
         parent->children[i] = parent->children[i + 1];
+        parent->children[i]->index = i;
     }
 
     return child;
 }
 
 /**
- * Pretty-prints an abstract syntax tree to the console.
- *
- * @param  parent  The subtree to print.
- * @param  prefix  The string prefix for the current level.
- * @param  is_tail Indicates if the current level is a tail child to the parent.
- * @return         An error code.
+ * Puts a node in the place of another node in its parent's child list.
+ */
+Error (ast_replace)(ASTNode* node, ASTNode* replacement)
+{
+    // make sure pointer isn't null
+    if (node == NULL || replacement == NULL || node->parent == NULL) {
+        return error(E_BAD_POINTER, "Bad pointer");
+    }
+
+    // a node can only be in one place at a time
+    if (replacement->parent != NULL) {
+        ast_detach(replacement);
+    }
+
+    ASTNode* parent = node->parent;
+    parent->children[node->index] = replacement;
+    replacement->parent = parent;
+    replacement->index = node->index;
+    node->parent = NULL;
+
+    return E_SUCCESS;
+}
+
+/**
+ * Puts the children of a node in the place of the node in its parent's child
+ * list, in order.
+ */
+Error (ast_splice)(Arena* arena, ASTNode* node)
+{
+    // make sure pointer isn't null
+    if (node == NULL || node->parent == NULL) {
+        return error(E_BAD_POINTER, "Bad pointer");
+    }
+
+    ASTNode* parent = node->parent;
+    unsigned int index = node->index;
+    unsigned int count = node->child_count;
+
+    // with anything but exactly one child, the siblings after the node have
+    // to move to make room or to close the gap
+    if (count != 1) {
+        ast_reserve_children(arena, parent, parent->child_count - 1 + count);
+        memmove(
+            parent->children + index + count,
+            parent->children + index + 1,
+            (parent->child_count - index - 1) * sizeof(ASTNode*)
+        );
+        parent->child_count = parent->child_count - 1 + count;
+
+        for (unsigned int i = index + count; i < parent->child_count; ++i) {
+            parent->children[i]->index = i;
+        }
+    }
+
+    // move the children over
+    for (unsigned int i = 0; i < count; ++i) {
+        ASTNode* child = node->children[i];
+        parent->children[index + i] = child;
+        child->parent = parent;
+        child->index = index + i;
+    }
+
+    node->child_count = 0;
+    node->parent = NULL;
+
+    return E_SUCCESS;
+}
+
+/**
+ * Removes a node from its parent's child list.
+ */
+ASTNode* (ast_detach)(ASTNode* node)
+{
+    // make sure pointer isn't null
+    if (node == NULL || node->parent == NULL) {
+        error(E_BAD_POINTER, "Bad pointer");
+        return NULL;
+    }
+
+    return ast_remove_child(node->parent, node->index);
+}
+
+/**
+ * A node on the stack of a visit.
+ */
+typedef struct {
+    ASTNode* node;
+    unsigned int next_child;
+    bool descend;
+} ASTVisitFrame;
+
+/**
+ * Calls a visitor function on a node, timing it if the visitor wants.
+ */
+static inline ASTVisitAction ast_visit_call(ASTVisitor* visitor, ASTVisitFunction function, ASTNode* node)
+{
+    if (visitor->elapsed == NULL) {
+        return function(node, visitor->context);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    ASTVisitAction action = function(node, visitor->context);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    *visitor->elapsed += (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    return action;
+}
+
+/**
+ * Visits every node of a tree in order with a number of visitors at once.
+ */
+Error ast_visit(ASTNode* root, ASTVisitor* visitors, size_t count)
+{
+    // make sure pointer isn't null
+    if (root == NULL || visitors == NULL) {
+        return error(E_BAD_POINTER, "Bad pointer");
+    }
+
+    // the depth at which each visitor chose to skip a subtree, or 0 if it is
+    // still visiting
+    size_t skipped[count];
+    memset(skipped, 0, sizeof(skipped));
+
+    // start with a stack on our own stack and move to the heap for deep trees
+    ASTVisitFrame frames[AST_VISIT_STACK_SIZE];
+    ASTVisitFrame* stack = frames;
+    size_t capacity = AST_VISIT_STACK_SIZE;
+    size_t depth = 0;
+
+    ASTNode* node = root;
+    while (node != NULL) {
+        // visit the node before its children
+        ASTNode* parent = node->parent;
+        unsigned int index = node->index;
+        bool descend = false;
+        depth++;
+
+        for (size_t i = 0; i < count; i++) {
+            if (skipped[i] != 0) {
+                continue;
+            }
+
+            if (visitors[i].pre != NULL) {
+                ASTVisitAction action = ast_visit_call(&visitors[i], visitors[i].pre, node);
+
+                // another node may have been put in this one's place
+                if (parent != NULL) {
+                    node = parent->children[index];
+                }
+
+                if (action == AST_VISIT_SKIP) {
+                    skipped[i] = depth;
+                    continue;
+                }
+            }
+
+            descend = true;
+        }
+
+        // push the node
+        if (depth > capacity) {
+            capacity <<= 1;
+            if (stack == frames) {
+                stack = malloc(sizeof(ASTVisitFrame) * capacity);
+                memcpy(stack, frames, sizeof(frames));
+            } else {
+                stack = realloc(stack, sizeof(ASTVisitFrame) * capacity);
+            }
+        }
+        stack[depth - 1] = (ASTVisitFrame){node, 0, descend};
+
+        // go back up until a node has children left to visit
+        node = NULL;
+        while (depth > 0) {
+            ASTVisitFrame* frame = &stack[depth - 1];
+            if (frame->descend && frame->next_child < frame->node->child_count) {
+                node = frame->node->children[frame->next_child++];
+                break;
+            }
+
+            // visit the node after its children
+            for (size_t i = 0; i < count; i++) {
+                if (skipped[i] == depth) {
+                    skipped[i] = 0;
+                } else if (skipped[i] == 0 && visitors[i].post != NULL) {
+                    ast_visit_call(&visitors[i], visitors[i].post, frame->node);
+                }
+            }
+
+            depth--;
+        }
+    }
+
+    if (stack != frames) {
+        free(stack);
+    }
+
+    return E_SUCCESS;
+}
+
+/**
+ * Gets the source representation of an operator.
+ */
+const char* ast_operator_string(ASTOperator operator)
+{
+    assert(operator < AST_OPERATOR_COUNT && ast_operator_strings[operator] != NULL);
+    return ast_operator_strings[operator];
+}
+
+/**
+ * Writes the value of a string or char literal with its escapes put back.
+ */
+void ast_write_escaped(FILE* stream, const char* value)
+{
+    for (; *value; value++) {
+        switch (*value) {
+            case '"':
+                fputs("\\\"", stream);
+                break;
+            case '\'':
+                fputs("\\'", stream);
+                break;
+            case '\\':
+                fputs("\\\\", stream);
+                break;
+            case '\t':
+                fputs("\\t", stream);
+                break;
+            case '\n':
+                fputs("\\n", stream);
+                break;
+            default:
+                fputc(*value, stream);
+        }
+    }
+}
+
+/**
+ * The state of a tree being pretty-printed.
+ */
+typedef struct {
+    /**
+     * The root node of the tree.
+     */
+    ASTNode* root;
+
+    /**
+     * The string prefix for the current level.
+     */
+    char* prefix;
+
+    /**
+     * The length of the prefix.
+     */
+    size_t length;
+
+    /**
+     * The size of the prefix buffer.
+     */
+    size_t capacity;
+} ASTPrintState;
+
+/**
+ * Checks if a node being printed is a tail child to its parent.
+ */
+static inline bool ast_print_is_tail(ASTPrintState* state, ASTNode* node)
+{
+    return node == state->root || node->index == node->parent->child_count - 1;
+}
+
+/**
+ * Pretty-prints a node of an abstract syntax tree to the console, and extends
+ * the prefix for its children.
  *
  * Here there be dragons, because string manipulation is not fun in C.
  */
-static Error ast_print_subtree(ASTNode* parent, const char* prefix, bool is_tail)
+static ASTVisitAction ast_print_enter(ASTNode* parent, void* context)
 {
+    ASTPrintState* state = context;
+    bool is_tail = ast_print_is_tail(state, parent);
+
     // print out the current node branch and file position
-    printf("%s%s [%d:%d]: ", prefix, is_tail ? "└──" : "├──", parent->line, parent->column);
+    printf("%s%s [%d:%d]: ", state->prefix, is_tail ? "└──" : "├──", parent->line, parent->column);
 
     // print out a unique readable string identifying the node kind and attributes
     switch (parent->kind) {
@@ -168,16 +533,20 @@ static Error ast_print_subtree(ASTNode* parent, const char* prefix, bool is_tail
 
         // literals
         case AST_INT_LITERAL:
-            printf("%d", *(int*)parent->value);
+            printf("%ld", parent->value.int_value);
             break;
         case AST_BOOLEAN_LITERAL:
-            printf("\"%s\"", (*(bool*)parent->value) ? "true" : "false");
+            printf("\"%s\"", parent->value.bool_value ? "true" : "false");
             break;
         case AST_CHAR_LITERAL:
-            printf("\"%s\"", (char*)parent->value);
+            printf("\"");
+            ast_write_escaped(stdout, (char[]){parent->value.char_value, '\0'});
+            printf("\"");
             break;
         case AST_STRING_LITERAL:
-            printf("\"%s\"", (char*)parent->value);
+            printf("\"");
+            ast_write_escaped(stdout, parent->value.string_value);
+            printf("\"");
             break;
 
         // declaration kinds
@@ -214,13 +583,13 @@ static Error ast_print_subtree(ASTNode* parent, const char* prefix, bool is_tail
 
         // operator kinds
         case AST_UNARY_OP:
-            printf("unary op { operator: %s }", ((ASTOperation*)parent)->operator);
+            printf("unary op { operator: %s }", ast_operator_string(((ASTOperation*)parent)->operator));
             break;
         case AST_BINARY_OP:
-            printf("binary op { operator: %s }", ((ASTOperation*)parent)->operator);
+            printf("binary op { operator: %s }", ast_operator_string(((ASTOperation*)parent)->operator));
             break;
         case AST_ASSIGN_OP:
-            printf("assignment { operator: %s }", ((ASTOperation*)parent)->operator);
+            printf("assignment { operator: %s }", ast_operator_string(((ASTOperation*)parent)->operator));
             break;
 
         // unknown
@@ -235,63 +604,43 @@ static Error ast_print_subtree(ASTNode* parent, const char* prefix, bool is_tail
 
     printf("\r\n");
 
-    // print every child node recursively
-    for (int i = 0; i < parent->child_count; i++) {
-        // append to the prefix
-        char* child_prefix = (char*)malloc(strlen(prefix) + 7);
-        strcpy(child_prefix, prefix);
-        strcat(child_prefix, is_tail ? "    " : "│   ");
-
-        // print the child
-        Error e;
-        if ((e = ast_print_subtree(parent->children[i], child_prefix, i == parent->child_count - 1)) != E_SUCCESS) {
-            return e;
-        }
-
-        // clean up our mess
-        free(child_prefix);
+    // append to the prefix for the children
+    const char* segment = is_tail ? "    " : "│   ";
+    size_t length = strlen(segment);
+    if (state->length + length + 1 > state->capacity) {
+        state->capacity = (state->length + length + 1) << 1;
+        state->prefix = realloc(state->prefix, state->capacity);
     }
+    strcpy(state->prefix + state->length, segment);
+    state->length += length;
 
-    return E_SUCCESS;
+    return AST_VISIT_CONTINUE;
 }
 
 /**
- * Pretty-prints an abstract syntax tree to the console.
+ * Takes back the prefix a node added for its children once they are printed.
  */
-Error ast_print(ASTNode* parent)
+static ASTVisitAction ast_print_leave(ASTNode* node, void* context)
 {
-    return ast_print_subtree(parent, "", true);
+    ASTPrintState* state = context;
+
+    state->length -= strlen(ast_print_is_tail(state, node) ? "    " : "│   ");
+    state->prefix[state->length] = '\0';
+
+    return AST_VISIT_CONTINUE;
 }
 
 /**
- * Destroys an abstract syntax tree node and all its children.
+ * Pretty-prints an abstract syntax tree to the console.
  */
-Error ast_destroy(ASTNode** node)
+Error ast_print(ASTNode* parent)
 {
-    // make sure pointer isn't null
-    if (node == NULL || *node == NULL) {
-        return error(E_BAD_POINTER, "Invalid AST node pointer");
-    }
-
-    // destroy child nodes, from left to right
-    for (int i = 0; i < (*node)->child_count; i++) {
-        // destroy child node
-        if (ast_destroy(&(*node)->children[i]) != E_SUCCESS) {
-            return E_BAD_POINTER;
-        }
-    }
+    ASTPrintState state = {parent, calloc(1, 1), 0, 1};
+    ASTVisitor visitor = {ast_print_enter, ast_print_leave, &state, NULL};
 
-    // free the children array
-    free((*node)->children);
+    Error e = ast_visit(parent, &visitor, 1);
 
-    // destroy the associated value if it has one
-    if ((*node)->value != NULL) {
-        free((*node)->value);
-    }
-
-    // destroy current node
-    free(*node);
-    *node = NULL;
-
-    return E_SUCCESS;
+    // clean up our mess
+    free(state.prefix);
+    return e;
 }
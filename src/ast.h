@@ -2,15 +2,26 @@
 #define WALRUS_AST_H
 
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include "arena.h"
 #include "symbol_table.h"
 #include "tokens.h"
 #include "types.h"
 
+// number of child slots set aside for nodes that hold lists of any length
+#define AST_INITIAL_CHILD_CAPACITY 4
+
+// number of levels a visit goes down before it has to allocate a bigger stack
+#define AST_VISIT_STACK_SIZE 64
+
 // macros for doing proper node type casting for us
 #define ast_get_child_index(parent, child) (ast_get_child_index)((ASTNode*)parent, (ASTNode*)child)
-#define ast_add_child(parent, child) (ast_add_child)((ASTNode*)parent, (ASTNode*)child)
-#define ast_remove_child(parent, child_index) (ast_add_child)((ASTNode*)parent, child_index)
+#define ast_add_child(arena, parent, child) (ast_add_child)(arena, (ASTNode*)parent, (ASTNode*)child)
+#define ast_remove_child(parent, child_index) (ast_remove_child)((ASTNode*)parent, child_index)
+#define ast_replace(node, replacement) (ast_replace)((ASTNode*)node, (ASTNode*)replacement)
+#define ast_splice(arena, node) (ast_splice)(arena, (ASTNode*)node)
+#define ast_detach(node) (ast_detach)((ASTNode*)node)
 
 
 /**
@@ -56,6 +67,44 @@ typedef enum {
     AST_ASSIGN_OP               = 0x33
 } ASTNodeKind;
 
+/**
+ * An enumeration of all operators an operation node can apply.
+ */
+typedef enum {
+    // arithmetic operators
+    OP_ADD,                 // +
+    OP_SUBTRACT,            // -
+    OP_MULTIPLY,            // *
+    OP_DIVIDE,              // /
+    OP_MODULO,              // %
+
+    // relational operators
+    OP_LESSER,              // <
+    OP_LESSER_OR_EQUAL,     // <=
+    OP_GREATER_OR_EQUAL,    // >=
+    OP_GREATER,             // >
+
+    // equality operators
+    OP_EQUAL,               // ==
+    OP_NOT_EQUAL,           // !=
+
+    // conditional operators
+    OP_AND,                 // &&
+    OP_OR,                  // ||
+
+    // unary operators
+    OP_NEGATE,              // -
+    OP_NOT,                 // !
+
+    // assignment operators
+    OP_ASSIGN,              // =
+    OP_ADD_ASSIGN,          // +=
+    OP_SUBTRACT_ASSIGN      // -=
+} ASTOperator;
+
+// number of operators; must follow the last one
+#define AST_OPERATOR_COUNT (OP_SUBTRACT_ASSIGN + 1)
+
 /**
  * Generic syntax tree node.
  */
@@ -66,9 +115,9 @@ typedef struct ASTNode {
     ASTNodeKind kind;
 
     /**
-     * The source file the node came from.
+     * The data type of this expression, if relevant.
      */
-    char* file;
+    DataType type;
 
     /**
      * The line number the node was found in the source file.
@@ -81,24 +130,34 @@ typedef struct ASTNode {
     unsigned int column;
 
     /**
-     * A pointer to any value you like.
+     * The number of nodes in the array.
      */
-    void* value;
+    unsigned int child_count;
 
     /**
-     * The data type of this expression, if relevant.
+     * The number of nodes the array has room for.
      */
-    DataType type;
+    unsigned int child_capacity;
 
     /**
-     * The size of the array.
+     * The position of this node in the children array of its parent.
      */
-    size_t child_size;
+    unsigned int index;
 
     /**
-     * The number of nodes in the array.
+     * The source file the node came from.
      */
-    unsigned int child_count;
+    char* file;
+
+    /**
+     * The value of a literal node, stored in the node itself.
+     */
+    union {
+        long int_value;           // AST_INT_LITERAL
+        bool bool_value;          // AST_BOOLEAN_LITERAL
+        char char_value;          // AST_CHAR_LITERAL
+        const char* string_value; // AST_STRING_LITERAL, as an interned string
+    } value;
 
     /**
      * A pointer to the start of the array.
@@ -118,9 +177,9 @@ typedef struct {
     ASTNode super;
 
     /**
-     * The identifier name of this declaration.
+     * The identifier name of this declaration, as an interned string.
      */
-    char* identifier;
+    const char* identifier;
 
     /**
      * Information about the symbol referred.
@@ -142,9 +201,9 @@ typedef struct {
     ASTNode super;
 
     /**
-     * The data type of this declaration.
+     * The operator applied.
      */
-    char* operator;
+    ASTOperator operator;
 } ASTOperation;
 
 /**
@@ -154,28 +213,79 @@ typedef struct {
     ASTNode super;
 
     /**
-     * The variable identifier name.
+     * The variable identifier name, as an interned string.
      */
-    char* identifier;
+    const char* identifier;
 } ASTReference;
 
+/**
+ * What a visitor wants to happen after visiting a node before its children.
+ */
+typedef enum {
+    AST_VISIT_CONTINUE,     // go on to visit the children of the node
+    AST_VISIT_SKIP          // leave out the children and the visit after them
+} ASTVisitAction;
+
+/**
+ * A function called when a visit reaches a node.
+ */
+typedef ASTVisitAction (*ASTVisitFunction)(ASTNode* node, void* context);
+
+/**
+ * A set of functions to call on each node of a tree during a visit.
+ */
+typedef struct {
+    /**
+     * Called on a node before its children, if not NULL.
+     *
+     * It may put a different node in the place of the visited one, but must
+     * not detach it. The replacement is what visitors later in the list get
+     * and what all visitors visit the children of and after; visitors earlier
+     * in the list have already seen the old node before its children.
+     */
+    ASTVisitFunction pre;
+
+    /**
+     * Called on a node after its children, if not NULL.
+     */
+    ASTVisitFunction post;
+
+    /**
+     * The value to pass along to the functions.
+     */
+    void* context;
+
+    /**
+     * If not NULL, the seconds spent in the functions are added to this.
+     */
+    double* elapsed;
+} ASTVisitor;
+
 /**
  * Creates an abstract syntax tree node.
  *
- * @param  kind The kind of node.
- * @param  file The file name the node was found in.
- * @return      A shiny new abstract syntax tree node.
+ * The node lives in the given arena along with the rest of its tree; there is
+ * no destroying nodes one by one. The whole tree is freed in one go when the
+ * arena is destroyed. Room for as many children as nodes of the kind usually
+ * have is allocated right along with the node.
+ *
+ * @param  arena The arena to allocate the node from.
+ * @param  kind  The kind of node.
+ * @param  file  The file name the node was found in.
+ * @return       A shiny new abstract syntax tree node.
  *
  * Be careful; the type and size of the allocated node returned varies depending
  * on the kind given. Proper casting is required to avoid memory bound errors.
  * See the comments in the declaration of ASTNodeKind to see what struct types
  * are returned.
  */
-void* ast_create_node(ASTNodeKind kind, char* file);
+void* ast_create_node(Arena* arena, ASTNodeKind kind, char* file);
 
 /**
  * Gets the position of a child in a parent node's child list.
  *
+ * Nodes keep track of their own position, so this takes constant time.
+ *
  * @param  parent The parent node.
  * @param  child  The child node.
  * @return        The index of the child, or -1 if the child does not belong to
@@ -186,17 +296,20 @@ int (ast_get_child_index)(ASTNode* parent, ASTNode* child);
 /**
  * Adds an abstract syntax tree node to another node as a child.
  *
+ * @param  arena  The arena of the tree, in case the parent needs a bigger
+ *                children array.
  * @param  parent The node to add a child to.
  * @param  child  The node add to parent as a child.
  * @return        An error code.
  */
-Error (ast_add_child)(ASTNode* parent, ASTNode* child);
+Error (ast_add_child)(Arena* arena, ASTNode* parent, ASTNode* child);
 
 /**
  * Removes an abstract syntax tree node from its parent by its child index.
  *
- * This does not destroy the removed node. If you want to destroy the removed
- * node forever, you must explicitly pass it to ast_destroy().
+ * The removed node stays allocated until its arena is destroyed. Children after
+ * the removed one move up a place, so this takes time proportional to how many
+ * there are.
  *
  * @param  parent The parent node.
  * @param  child  The index of the child node to remove.
@@ -205,18 +318,81 @@ Error (ast_add_child)(ASTNode* parent, ASTNode* child);
 ASTNode* (ast_remove_child)(ASTNode* parent, unsigned int child_index);
 
 /**
- * Pretty-prints an abstract syntax tree to the console.
+ * Puts a node in the place of another node in its parent's child list.
  *
- * @param  parent The subtree to print.
+ * The replaced node is left without a parent; it stays allocated until its
+ * arena is destroyed. If the replacement belongs to a parent itself, it is
+ * detached from it first. Replacing a node with a detached node or with its
+ * only child takes constant time.
+ *
+ * @param  node        The node to replace.
+ * @param  replacement The node to put in its place.
+ * @return             An error code.
  */
-Error ast_print(ASTNode* parent);
+Error (ast_replace)(ASTNode* node, ASTNode* replacement);
+
+/**
+ * Puts the children of a node in the place of the node in its parent's child
+ * list, in order.
+ *
+ * The spliced out node is left without a parent or children. Splicing out a
+ * node with exactly one child takes constant time.
+ *
+ * @param  arena The arena of the tree, in case the parent needs a bigger
+ *               children array; may be NULL if the node has at most one child.
+ * @param  node  The node to splice out.
+ * @return       An error code.
+ */
+Error (ast_splice)(Arena* arena, ASTNode* node);
+
+/**
+ * Removes a node from its parent's child list.
+ *
+ * Works like ast_remove_child(), but by node. Detaching the last child of a
+ * parent takes constant time.
+ *
+ * @param  node The node to detach.
+ * @return      The node detached.
+ */
+ASTNode* (ast_detach)(ASTNode* node);
+
+/**
+ * Visits every node of a tree in order with a number of visitors at once.
+ *
+ * The visitors take turns on each node in the order given, so running several
+ * visitors in one visit works the same as running them one at a time, as long
+ * as no visitor depends on another having seen the whole tree. The tree is
+ * walked with an explicit stack, so even very deep trees can be visited.
+ *
+ * @param  root     The root node of the tree to visit.
+ * @param  visitors The visitors.
+ * @param  count    The number of visitors.
+ * @return          An error code.
+ */
+Error ast_visit(ASTNode* root, ASTVisitor* visitors, size_t count);
 
 /**
- * Destroys an abstract syntax tree node and all its children.
+ * Gets the source representation of an operator.
  *
- * @param  node The node to destroy.
- * @return      An error code.
+ * @param  operator The operator.
+ * @return          The operator as it would be written in source.
  */
-Error ast_destroy(ASTNode** node);
+const char* ast_operator_string(ASTOperator operator);
+
+/**
+ * Writes the decoded value of a string or char literal the way it would be
+ * written in source, with escape sequences for special characters.
+ *
+ * @param  stream The stream to write to.
+ * @param  value  The decoded value of the literal.
+ */
+void ast_write_escaped(FILE* stream, const char* value);
+
+/**
+ * Pretty-prints an abstract syntax tree to the console.
+ *
+ * @param  parent The subtree to print.
+ */
+Error ast_print(ASTNode* parent);
 
 #endif
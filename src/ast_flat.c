@@ -0,0 +1,522 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ast.h"
+#include "ast_flat.h"
+#include "error.h"
+#include "intern.h"
+
+// version of the binary tree format; bump it whenever ASTFlatNode changes
+#define AST_FLAT_VERSION 1
+
+// initial size of the string table of a tree being flattened
+#define AST_FLAT_INITIAL_STRING_CAPACITY 4096
+
+// rounds an offset in a binary tree file up so the array after it is aligned
+#define AST_FLAT_ALIGN(offset) (((offset) + 7) & ~(size_t)7)
+
+
+/**
+ * A node waiting to be copied, along with where it goes in its parent.
+ */
+typedef struct {
+    ASTNode* node;
+    ASTIndex parent;
+    uint32_t child_index;
+} ASTFlatPending;
+
+/**
+ * A string table being built, with every distinct string stored once.
+ */
+typedef struct {
+    char* buffer;
+    uint32_t size;
+    uint32_t capacity;
+
+    // the offset of each interned string in the table, indexed by its id
+    uint32_t* offsets;
+    unsigned int offset_count;
+} ASTFlatStrings;
+
+/**
+ * The header at the start of a binary tree file.
+ */
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t node_size;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t string_size;
+} ASTFlatHeader;
+
+// magic bytes that start a binary tree file
+static const char ast_flat_magic[4] = {'W', 'A', 'S', 'T'};
+
+
+/**
+ * Counts the nodes in a syntax tree.
+ */
+static uint32_t ast_flat_count(ASTNode* root)
+{
+    size_t capacity = 1024;
+    ASTNode** stack = malloc(sizeof(ASTNode*) * capacity);
+    uint32_t count = 0;
+    size_t top = 0;
+
+    stack[top++] = root;
+    while (top > 0) {
+        ASTNode* node = stack[--top];
+        count++;
+
+        // make room for the children
+        if (top + node->child_count > capacity) {
+            while (top + node->child_count > capacity) {
+                capacity <<= 1;
+            }
+            stack = realloc(stack, sizeof(ASTNode*) * capacity);
+        }
+        for (int i = 0; i < node->child_count; i++) {
+            stack[top++] = node->children[i];
+        }
+    }
+
+    free(stack);
+    return count;
+}
+
+/**
+ * Appends a string to a string table being built and returns its offset.
+ */
+static uint32_t ast_flat_append_string(ASTFlatStrings* strings, const char* string)
+{
+    uint32_t length = strlen(string) + 1;
+
+    // reallocate if full
+    if (strings->size + length > strings->capacity) {
+        while (strings->size + length > strings->capacity) {
+            strings->capacity <<= 1;
+        }
+        strings->buffer = realloc(strings->buffer, strings->capacity);
+    }
+
+    uint32_t offset = strings->size;
+    memcpy(strings->buffer + offset, string, length);
+    strings->size += length;
+
+    return offset;
+}
+
+/**
+ * Adds an interned string to a string table being built, unless it is in there
+ * already, and returns its offset.
+ */
+static uint32_t ast_flat_add_string(ASTFlatStrings* strings, const char* interned)
+{
+    if (interned == NULL) {
+        return AST_FLAT_NONE;
+    }
+
+    // interned strings are numbered densely from 1, so their ids make a
+    // perfect hash
+    unsigned int id = intern_id(interned);
+    if (id >= strings->offset_count) {
+        unsigned int count = strings->offset_count;
+        while (id >= strings->offset_count) {
+            strings->offset_count <<= 1;
+        }
+        strings->offsets = realloc(strings->offsets, sizeof(uint32_t) * strings->offset_count);
+        memset(strings->offsets + count, 0xFF, sizeof(uint32_t) * (strings->offset_count - count));
+    }
+
+    if (strings->offsets[id] == AST_FLAT_NONE) {
+        strings->offsets[id] = ast_flat_append_string(strings, interned);
+    }
+
+    return strings->offsets[id];
+}
+
+/**
+ * Copies a syntax tree into a flat syntax tree.
+ */
+ASTFlat* ast_flat_create(ASTNode* root)
+{
+    ASTFlat* ast = malloc(sizeof(ASTFlat));
+    ast->mapping = NULL;
+    ast->mapping_size = 0;
+
+    // the source file name always comes first in the string table
+    ASTFlatStrings strings = {
+        malloc(AST_FLAT_INITIAL_STRING_CAPACITY), 0, AST_FLAT_INITIAL_STRING_CAPACITY,
+        malloc(sizeof(uint32_t) * 256), 256
+    };
+    memset(strings.offsets, 0xFF, sizeof(uint32_t) * strings.offset_count);
+    ast_flat_append_string(&strings, root->file);
+
+    uint32_t count = ast_flat_count(root);
+    ast->node_count = count;
+    // zeroed, so the padding inside nodes is the same every time a tree is
+    // written out
+    ast->nodes = calloc(count, sizeof(ASTFlatNode));
+    // every node but the root is the child of exactly one other
+    ast->children = malloc(sizeof(ASTIndex) * (count > 1 ? count - 1 : 1));
+
+    // copy nodes in preorder; children are pushed in reverse so the first
+    // child is copied first, and there are never more nodes pending than
+    // there are nodes
+    ASTFlatPending* stack = malloc(sizeof(ASTFlatPending) * count);
+    uint32_t next_child = 0;
+    ASTIndex index = 0;
+    size_t top = 0;
+
+    stack[top++] = (ASTFlatPending){root, AST_FLAT_NONE, 0};
+    while (top > 0) {
+        ASTFlatPending pending = stack[--top];
+        ASTNode* node = pending.node;
+        ASTFlatNode* flat = &ast->nodes[index];
+
+        flat->kind = node->kind;
+        flat->type = node->type;
+        flat->line = node->line;
+        flat->column = node->column;
+        flat->parent = pending.parent;
+        flat->end = index + 1;
+        flat->first_child = next_child;
+        flat->child_count = node->child_count;
+        flat->flags = 0;
+        flat->length = 0;
+        flat->value.int_value = node->value.int_value;
+
+        if ((node->kind & 0xF) == AST_DECL) {
+            flat->flags = ((ASTDecl*)node)->flags;
+            flat->length = ((ASTDecl*)node)->length;
+            flat->value.int_value = 0;
+            flat->value.string = ast_flat_add_string(&strings, ((ASTDecl*)node)->identifier);
+        } else if ((node->kind & 0xF) == AST_REFERENCE) {
+            flat->value.int_value = 0;
+            flat->value.string = ast_flat_add_string(&strings, ((ASTReference*)node)->identifier);
+        } else if (node->kind == AST_STRING_LITERAL) {
+            flat->value.int_value = 0;
+            flat->value.string = ast_flat_add_string(&strings, node->value.string_value);
+        } else if ((node->kind & 0xF) == AST_OP_EXPR) {
+            flat->value.operator = ((ASTOperation*)node)->operator;
+        }
+
+        // claim a contiguous range of the child list for the children
+        next_child += node->child_count;
+
+        if (pending.parent != AST_FLAT_NONE) {
+            ASTFlatNode* parent = &ast->nodes[pending.parent];
+            ast->children[parent->first_child + pending.child_index] = index;
+        }
+
+        for (int i = node->child_count - 1; i >= 0; i--) {
+            stack[top++] = (ASTFlatPending){node->children[i], index, i};
+        }
+
+        index++;
+    }
+    free(stack);
+
+    free(strings.offsets);
+    ast->strings = strings.buffer;
+    ast->string_size = strings.size;
+    ast->file = ast->strings;
+
+    // every subtree ends where the subtree of its last child ends; children
+    // always come after their parents, so walk backwards
+    for (ASTIndex i = count; i-- > 0;) {
+        ASTFlatNode* flat = &ast->nodes[i];
+        if (flat->child_count > 0) {
+            flat->end = ast->nodes[ast_flat_get_child(ast, i, flat->child_count - 1)].end;
+        }
+    }
+
+    return ast;
+}
+
+/**
+ * Gets the size of the child list of a flat syntax tree with the given number
+ * of nodes.
+ */
+static size_t ast_flat_get_child_list_size(uint32_t node_count)
+{
+    // every node but the root is the child of exactly one other
+    return node_count > 1 ? node_count - 1 : 0;
+}
+
+/**
+ * Writes a flat syntax tree to a binary file.
+ */
+Error ast_flat_write(ASTFlat* ast, const char* filename)
+{
+    // make sure pointer isn't null
+    if (ast == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    FILE* stream = fopen(filename, "wb");
+    if (stream == NULL) {
+        return error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
+    }
+
+    ASTFlatHeader header = {{0}};
+    memcpy(header.magic, ast_flat_magic, sizeof(ast_flat_magic));
+    header.version = AST_FLAT_VERSION;
+    header.node_size = sizeof(ASTFlatNode);
+    header.byte_order = 0x01020304;
+    header.node_count = ast->node_count;
+    header.string_size = ast->string_size;
+
+    // pad each section so the arrays stay aligned once mapped
+    static const char padding[8] = {0};
+    size_t nodes_offset = AST_FLAT_ALIGN(sizeof(ASTFlatHeader));
+    size_t children_size = sizeof(ASTIndex) * ast_flat_get_child_list_size(ast->node_count);
+
+    bool written = fwrite(&header, sizeof(ASTFlatHeader), 1, stream) == 1
+        && fwrite(padding, 1, nodes_offset - sizeof(ASTFlatHeader), stream) == nodes_offset - sizeof(ASTFlatHeader)
+        && fwrite(ast->nodes, sizeof(ASTFlatNode), ast->node_count, stream) == ast->node_count
+        && fwrite(ast->children, 1, children_size, stream) == children_size
+        && fwrite(ast->strings, 1, ast->string_size, stream) == ast->string_size;
+
+    if (fclose(stream) != 0 || !written) {
+        return error(E_OPERATION_FAILED, "Error writing to '%s'.", filename);
+    }
+
+    return E_SUCCESS;
+}
+
+/**
+ * Checks if a value read from a file is a node kind.
+ */
+static bool ast_flat_is_kind(ASTNodeKind kind)
+{
+    switch (kind) {
+        case AST_BLOCK:
+        case AST_IF_STATEMENT:
+        case AST_ELSE_STATEMENT:
+        case AST_FOR_STATEMENT:
+        case AST_BREAK_STATEMENT:
+        case AST_CONTINUE_STATEMENT:
+        case AST_RETURN_STATEMENT:
+        case AST_INT_LITERAL:
+        case AST_BOOLEAN_LITERAL:
+        case AST_CHAR_LITERAL:
+        case AST_STRING_LITERAL:
+        case AST_CLASS_DECL:
+        case AST_FIELD_DECL:
+        case AST_METHOD_DECL:
+        case AST_VAR_DECL:
+        case AST_PARAM_DECL:
+        case AST_LOCATION:
+        case AST_METHOD_CALL:
+        case AST_CALLOUT:
+        case AST_UNARY_OP:
+        case AST_BINARY_OP:
+        case AST_ASSIGN_OP:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * Checks that a loaded tree is a proper tree, so a damaged or crafted file
+ * can't make anyone read outside of the mapping or of a lookup table, or walk
+ * around in circles.
+ */
+static bool ast_flat_validate(ASTFlat* ast)
+{
+    size_t child_list_size = ast_flat_get_child_list_size(ast->node_count);
+    size_t child_total = 0;
+
+    // the file name comes first, and every string must be terminated
+    if (ast->string_size == 0 || ast->strings[ast->string_size - 1] != '\0') {
+        return false;
+    }
+
+    for (ASTIndex i = 0; i < ast->node_count; i++) {
+        ASTFlatNode* node = &ast->nodes[i];
+
+        // enums must hold values this compiler knows about
+        if (!ast_flat_is_kind(node->kind) || (unsigned int)node->type > TYPE_VOID) {
+            return false;
+        }
+        if ((node->kind & 0xF) == AST_OP_EXPR && (unsigned int)node->value.operator >= AST_OPERATOR_COUNT) {
+            return false;
+        }
+
+        // parents come before their children, and only the root has none
+        if (i == 0 ? node->parent != AST_FLAT_NONE : node->parent >= i) {
+            return false;
+        }
+        if (node->end <= i || node->end > ast->node_count) {
+            return false;
+        }
+        if ((size_t)node->first_child + node->child_count > child_list_size) {
+            return false;
+        }
+
+        // children come after their parent and each other in preorder and
+        // point back at their parent, so no node is shared and there are no
+        // cycles
+        ASTIndex previous = i;
+        for (uint32_t c = 0; c < node->child_count; c++) {
+            ASTIndex child = ast_flat_get_child(ast, i, c);
+            if (child <= previous || child >= node->end || ast->nodes[child].parent != i) {
+                return false;
+            }
+            previous = child;
+        }
+        child_total += node->child_count;
+
+        bool has_string = (node->kind & 0xF) == AST_DECL
+            || (node->kind & 0xF) == AST_REFERENCE
+            || node->kind == AST_STRING_LITERAL;
+        if (has_string && node->value.string != AST_FLAT_NONE && node->value.string >= ast->string_size) {
+            return false;
+        }
+    }
+
+    // no node is listed twice, so this means every node but the root is listed
+    // under its parent
+    return child_total == child_list_size;
+}
+
+/**
+ * Loads a flat syntax tree from a binary file.
+ */
+ASTFlat* ast_flat_load(const char* filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
+        return NULL;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size < sizeof(ASTFlatHeader)) {
+        close(fd);
+        error(E_OPERATION_FAILED, "The file '%s' is not a syntax tree.", filename);
+        return NULL;
+    }
+
+    // map the file privately and writable, so the tree can be changed in
+    // memory without touching the file
+    void* mapping = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error(E_OPERATION_FAILED, "The file '%s' could not be mapped.", filename);
+        return NULL;
+    }
+
+    // the file must have been written by a compatible build
+    ASTFlatHeader* header = mapping;
+    if (memcmp(header->magic, ast_flat_magic, sizeof(ast_flat_magic)) != 0
+        || header->version != AST_FLAT_VERSION
+        || header->node_size != sizeof(ASTFlatNode)
+        || header->byte_order != 0x01020304) {
+        munmap(mapping, info.st_size);
+        error(E_OPERATION_FAILED, "The file '%s' is not a syntax tree this compiler can read.", filename);
+        return NULL;
+    }
+
+    size_t nodes_offset = AST_FLAT_ALIGN(sizeof(ASTFlatHeader));
+    size_t children_offset = nodes_offset + sizeof(ASTFlatNode) * (size_t)header->node_count;
+    size_t strings_offset = children_offset
+        + sizeof(ASTIndex) * ast_flat_get_child_list_size(header->node_count);
+
+    ASTFlat* ast = malloc(sizeof(ASTFlat));
+    ast->node_count = header->node_count;
+    ast->nodes = (ASTFlatNode*)((char*)mapping + nodes_offset);
+    ast->children = (ASTIndex*)((char*)mapping + children_offset);
+    ast->strings = (char*)mapping + strings_offset;
+    ast->string_size = header->string_size;
+    ast->file = ast->strings;
+    ast->mapping = mapping;
+    ast->mapping_size = info.st_size;
+
+    if (header->node_count == 0
+        || strings_offset + header->string_size != info.st_size
+        || !ast_flat_validate(ast)) {
+        error(E_OPERATION_FAILED, "The file '%s' is not a syntax tree.", filename);
+        ast_flat_destroy(&ast);
+        return NULL;
+    }
+
+    return ast;
+}
+
+/**
+ * Skips writing the tree if the program has errors in it; analysis has run by
+ * the time this pass begins.
+ */
+static Error ast_flat_begin(ASTNode* root, void* context)
+{
+    return error_get_last();
+}
+
+/**
+ * Flattens the analyzed tree and writes it out.
+ */
+static Error ast_flat_end(ASTNode* root, void* context)
+{
+    // append .ast to the filename to write to
+    size_t size = strlen(root->file) + 5;
+    char* filename = malloc(size);
+    snprintf(filename, size, "%s.ast", root->file);
+
+    ASTFlat* ast = ast_flat_create(root);
+    Error e = ast_flat_write(ast, filename);
+
+    ast_flat_destroy(&ast);
+    free(filename);
+    return e;
+}
+
+/**
+ * Gets the pass that writes the analyzed tree to a binary file.
+ */
+Pass ast_flat_pass(void)
+{
+    return (Pass){
+        "emit-ast",
+        false,
+        false,
+        ast_flat_begin,
+        NULL,
+        NULL,
+        ast_flat_end,
+        NULL
+    };
+}
+
+/**
+ * Destroys a flat syntax tree.
+ */
+Error ast_flat_destroy(ASTFlat** ast)
+{
+    // make sure pointer isn't null
+    if (ast == NULL || *ast == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    // a loaded tree lives in its mapping
+    if ((*ast)->mapping != NULL) {
+        munmap((*ast)->mapping, (*ast)->mapping_size);
+    } else {
+        free((*ast)->nodes);
+        free((*ast)->children);
+        free((*ast)->strings);
+    }
+    free(*ast);
+    *ast = NULL;
+
+    return E_SUCCESS;
+}
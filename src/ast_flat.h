@@ -0,0 +1,218 @@
+#ifndef WALRUS_AST_FLAT_H
+#define WALRUS_AST_FLAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+#include "pass_manager.h"
+#include "symbol_table.h"
+#include "types.h"
+
+// index used where a flat node has no parent, or offset used where it has no
+// string
+#define AST_FLAT_NONE UINT32_MAX
+
+
+/**
+ * The position of a node in a flat syntax tree.
+ */
+typedef uint32_t ASTIndex;
+
+/**
+ * A syntax tree node stored by value in a flat syntax tree.
+ *
+ * Nodes are laid out in preorder, so a node's descendants always come right
+ * after it and before its next sibling.
+ */
+typedef struct {
+    /**
+     * The kind of node this node is.
+     */
+    ASTNodeKind kind;
+
+    /**
+     * The data type of this expression, if relevant.
+     */
+    DataType type;
+
+    /**
+     * The line number the node was found in the source file.
+     */
+    unsigned int line;
+
+    /**
+     * The column number the node was found in the source file.
+     */
+    unsigned int column;
+
+    /**
+     * The parent node of this one, or AST_FLAT_NONE for the root.
+     */
+    ASTIndex parent;
+
+    /**
+     * One past the index of the last node in the subtree of this node.
+     */
+    ASTIndex end;
+
+    /**
+     * Where the indices of the children of this node start in the child list.
+     */
+    uint32_t first_child;
+
+    /**
+     * The number of children of this node.
+     */
+    uint32_t child_count;
+
+    /**
+     * Declaration symbol flags, for declaration nodes.
+     */
+    SymbolFlags flags;
+
+    /**
+     * The length of the declaration, for declaration nodes.
+     */
+    unsigned int length;
+
+    /**
+     * The literal value of the node, its operator, or where its identifier or
+     * string literal starts in the string table.
+     */
+    union {
+        long int_value;
+        bool bool_value;
+        char char_value;
+        uint32_t string;
+        ASTOperator operator;
+    } value;
+} ASTFlatNode;
+
+/**
+ * A syntax tree stored in one contiguous array of nodes.
+ *
+ * Nodes refer to each other and to their strings by index only, so a flat tree
+ * can be written to a file as it is and mapped back into memory anywhere.
+ */
+typedef struct {
+    /**
+     * The source file the tree came from; always the first string in the
+     * string table.
+     */
+    char* file;
+
+    /**
+     * All nodes of the tree, in preorder; the root is node 0.
+     */
+    ASTFlatNode* nodes;
+
+    /**
+     * The number of nodes in the tree.
+     */
+    uint32_t node_count;
+
+    /**
+     * The indices of the children of every node, grouped by parent.
+     */
+    ASTIndex* children;
+
+    /**
+     * The null-terminated identifiers and string literals of the tree, back to
+     * back; every distinct string is stored once.
+     */
+    char* strings;
+
+    /**
+     * The size of the string table in bytes.
+     */
+    uint32_t string_size;
+
+    /**
+     * The mapped file the tree was loaded from, or NULL if the tree owns its
+     * arrays.
+     */
+    void* mapping;
+
+    /**
+     * The size of the mapped file.
+     */
+    size_t mapping_size;
+} ASTFlat;
+
+/**
+ * Copies a syntax tree into a flat syntax tree.
+ *
+ * @param  root The root node of the tree to copy.
+ * @return      A shiny new flat syntax tree.
+ */
+ASTFlat* ast_flat_create(ASTNode* root);
+
+/**
+ * Gets a child of a node in a flat syntax tree.
+ *
+ * @param  ast         The flat syntax tree.
+ * @param  index       The index of the parent node.
+ * @param  child_index The position of the child among its siblings.
+ * @return             The index of the child node.
+ */
+static inline ASTIndex ast_flat_get_child(ASTFlat* ast, ASTIndex index, uint32_t child_index)
+{
+    return ast->children[ast->nodes[index].first_child + child_index];
+}
+
+/**
+ * Gets the identifier or string literal of a node in a flat syntax tree.
+ *
+ * @param  ast   The flat syntax tree.
+ * @param  index The index of the node.
+ * @return       The string of the node, or NULL if it has none.
+ */
+static inline const char* ast_flat_get_string(ASTFlat* ast, ASTIndex index)
+{
+    uint32_t offset = ast->nodes[index].value.string;
+    return offset == AST_FLAT_NONE ? NULL : ast->strings + offset;
+}
+
+/**
+ * Writes a flat syntax tree to a binary file.
+ *
+ * The file holds a small header followed by the node array, the child list and
+ * the string table exactly as they are laid out in memory, so it can only be
+ * read back by a build for the same kind of machine.
+ *
+ * @param  ast      The tree to write.
+ * @param  filename The name of the file to write to.
+ * @return          An error code.
+ */
+Error ast_flat_write(ASTFlat* ast, const char* filename);
+
+/**
+ * Loads a flat syntax tree from a binary file written by ast_flat_write().
+ *
+ * The file is mapped into memory instead of being read, and the tree points
+ * right into the mapping. Changes made to the loaded tree are private and are
+ * never written back to the file.
+ *
+ * @param  filename The name of the file to load.
+ * @return          The loaded tree, or NULL if the file isn't a valid tree.
+ */
+ASTFlat* ast_flat_load(const char* filename);
+
+/**
+ * Gets the pass that writes the analyzed tree to a binary file named after the
+ * source file with .ast appended, unless analysis has failed.
+ *
+ * @return The pass.
+ */
+Pass ast_flat_pass(void);
+
+/**
+ * Destroys a flat syntax tree.
+ *
+ * @param  ast The tree to destroy.
+ * @return     An error code.
+ */
+Error ast_flat_destroy(ASTFlat** ast);
+
+#endif
@@ -1,6 +1,5 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <string.h>
 #include "error.h"
 #include "iloc_generator.h"
 
@@ -21,15 +20,46 @@ static const char* opcode_strings[] = {
  */
 static int next_register = 0;
 
+/**
+ * The program being generated by the code generation pass.
+ */
+static ILOCProgram* iloc_generator_program = NULL;
+
+
+/**
+ * Generates ILOC assembly code for an operation; shared by the generators for
+ * both kinds of syntax tree so they always agree.
+ */
+static void iloc_generator_generate_operation(ILOCProgram* program, ASTNodeKind kind, ASTOperator operator)
+{
+    // binary operation
+    if (kind == AST_BINARY_OP) {
+        switch (operator) {
+            // addition
+            case OP_ADD: {
+                ILOCInstruction* instr = iloc_instruction_create(ILOC_ADD);
+                instr->sources[0].type = ILOC_TYPE_REGISTER;
+                instr->sources[0].num = next_register++;
+                instr->sources[1].type = ILOC_TYPE_REGISTER;
+                instr->sources[1].num = next_register++;
+                instr->targets[0].type = ILOC_TYPE_REGISTER;
+                instr->targets[0].num = next_register++;
+                iloc_add_instruction(program, instr);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+}
 
 /**
  * Generates an ILOC assembly program from an abstract syntax tree.
  */
 ILOCProgram* iloc_generator_generate(ASTNode* root)
 {
-    ILOCProgram* program = malloc(sizeof(ILOCProgram));
-    program->first = NULL;
-    program->last = NULL;
+    ILOCProgram* program = iloc_program_create();
 
     // first, generate the instructions
     iloc_generator_generate_instructions(program, root);
@@ -41,39 +71,108 @@ ILOCProgram* iloc_generator_generate(ASTNode* root)
 }
 
 /**
- * Generates ILOC assembly code for an AST node.
+ * Generates an ILOC assembly program from a flat abstract syntax tree.
  */
-Error iloc_generator_generate_instructions(ILOCProgram* program, ASTNode* node)
+ILOCProgram* iloc_generator_generate_flat(ASTFlat* ast)
 {
-    // binary operation
-    if (node->kind == AST_BINARY_OP) {
-        // addition
-        if (strcmp(((ASTOperation*)node)->operator, "+") == 0) {
-            ILOCInstruction* instr = iloc_instruction_create(ILOC_ADD);
-            instr->sources[0].type = ILOC_TYPE_REGISTER;
-            instr->sources[0].num = next_register++;
-            instr->sources[1].type = ILOC_TYPE_REGISTER;
-            instr->sources[1].num = next_register++;
-            instr->targets[0].type = ILOC_TYPE_REGISTER;
-            instr->targets[0].num = next_register++;
-            iloc_add_instruction(program, instr);
+    ILOCProgram* program = iloc_program_create();
+
+    // nodes are stored in preorder, so one pass over the array visits them in
+    // the same order as the recursive walk
+    for (ASTIndex i = 0; i < ast->node_count; i++) {
+        ASTFlatNode* node = &ast->nodes[i];
+        if ((node->kind & 0xF) == AST_OP_EXPR) {
+            iloc_generator_generate_operation(program, node->kind, node->value.operator);
         }
     }
 
-    // generate code for each child node
-    for (int i = 0; i < node->child_count; ++i) {
-        iloc_generator_generate_instructions(program, node->children[i]);
+    return program;
+}
+
+/**
+ * Generates ILOC assembly code for a single AST node.
+ */
+static ASTVisitAction iloc_generator_enter_node(ASTNode* node, void* context)
+{
+    ILOCProgram* program = context;
+
+    if ((node->kind & 0xF) == AST_OP_EXPR) {
+        iloc_generator_generate_operation(program, node->kind, ((ASTOperation*)node)->operator);
+    }
+
+    return AST_VISIT_CONTINUE;
+}
+
+/**
+ * Generates ILOC assembly code for an AST node.
+ */
+Error iloc_generator_generate_instructions(ILOCProgram* program, ASTNode* node)
+{
+    // generate code for the node and each child node
+    ASTVisitor visitor = {iloc_generator_enter_node, NULL, program, NULL};
+    return ast_visit(node, &visitor, 1);
+}
+
+/**
+ * Starts the code generation pass, unless the program has errors.
+ */
+static Error iloc_generator_begin(ASTNode* root, void* filename)
+{
+    // a program with errors in it has no business being compiled
+    if (error_get_last()) {
+        return error_get_last();
     }
 
+    iloc_generator_program = iloc_program_create();
+
     return E_SUCCESS;
 }
 
+/**
+ * Generates ILOC assembly code for a single AST node in the generated program.
+ */
+static ASTVisitAction iloc_generator_enter_pass_node(ASTNode* node, void* filename)
+{
+    return iloc_generator_enter_node(node, iloc_generator_program);
+}
+
+/**
+ * Writes out the generated program and cleans up after the code generation
+ * pass.
+ */
+static Error iloc_generator_end(ASTNode* root, void* filename)
+{
+    Error written = iloc_generator_write(iloc_generator_program, filename);
+    iloc_program_destroy(&iloc_generator_program);
+    return written;
+}
+
+/**
+ * Gets the code generation pass.
+ */
+Pass iloc_generator_pass(char* filename)
+{
+    return (Pass){
+        "codegen",
+        false,
+        false,
+        iloc_generator_begin,
+        iloc_generator_enter_pass_node,
+        NULL,
+        iloc_generator_end,
+        filename
+    };
+}
+
 /**
  * Writes an ILOC assembly program to file.
  */
-void iloc_generator_write(ILOCProgram* program, char* filename)
+Error iloc_generator_write(ILOCProgram* program, char* filename)
 {
     FILE* stream = fopen(filename, "wb");
+    if (stream == NULL) {
+        return error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
+    }
 
     // loop over each instruction sequentially
     for (ILOCInstruction* instr = program->first; instr != NULL; instr = instr->next) {
@@ -124,7 +223,12 @@ void iloc_generator_write(ILOCProgram* program, char* filename)
         fprintf(stream, "\n");
     }
 
-    fclose(stream);
+    bool written = !ferror(stream);
+    if (fclose(stream) != 0 || !written) {
+        return error(E_OPERATION_FAILED, "Error writing to '%s'.", filename);
+    }
+
+    return E_SUCCESS;
 }
 
 /**
@@ -164,6 +268,17 @@ Error iloc_add_instruction(ILOCProgram* program, ILOCInstruction* instruction)
     return E_SUCCESS;
 }
 
+/**
+ * Creates an empty ILOC assembly program.
+ */
+ILOCProgram* iloc_program_create(void)
+{
+    ILOCProgram* program = malloc(sizeof(ILOCProgram));
+    program->first = NULL;
+    program->last = NULL;
+    return program;
+}
+
 /**
  * Destroys an ILOC program structure and frees its memory.
  */
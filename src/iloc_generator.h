@@ -3,7 +3,9 @@
 
 #include <stdio.h>
 #include "ast.h"
+#include "ast_flat.h"
 #include "error.h"
+#include "pass_manager.h"
 
 
 /**
@@ -130,6 +132,17 @@ typedef struct {
  */
 ILOCProgram* iloc_generator_generate(ASTNode* root);
 
+/**
+ * Generates an ILOC assembly program from a flat abstract syntax tree.
+ *
+ * Generates the same program as iloc_generator_generate(), visiting the nodes
+ * in the order they are stored in.
+ *
+ * @param  ast A flat abstract syntax tree.
+ * @return     A structure representing an ILOC assembly program.
+ */
+ILOCProgram* iloc_generator_generate_flat(ASTFlat* ast);
+
 /**
  * Generates ILOC assembly instructions for an AST node.
  *
@@ -139,13 +152,23 @@ ILOCProgram* iloc_generator_generate(ASTNode* root);
  */
 Error iloc_generator_generate_instructions(ILOCProgram* program, ASTNode* node);
 
+/**
+ * Gets the code generation pass, which generates an ILOC assembly program and
+ * writes it to a file, unless any errors have occurred by the time it starts.
+ *
+ * @param  filename The name of a file to write to.
+ * @return          The pass.
+ */
+Pass iloc_generator_pass(char* filename);
+
 /**
  * Writes an ILOC assembly program to file.
  *
- * @param program  An ILOC program to write.
- * @param filename The name of a file to write to.
+ * @param  program  An ILOC program to write.
+ * @param  filename The name of a file to write to.
+ * @return          An error code.
  */
-void iloc_generator_write(ILOCProgram* program, char* filename);
+Error iloc_generator_write(ILOCProgram* program, char* filename);
 
 /**
  * Creates an ILOC assembly instruction.
@@ -164,6 +187,13 @@ ILOCInstruction* iloc_instruction_create(ILOCOpcode opcode);
  */
 Error iloc_add_instruction(ILOCProgram* program, ILOCInstruction* instruction);
 
+/**
+ * Creates an empty ILOC assembly program.
+ *
+ * @return A new program without any instructions.
+ */
+ILOCProgram* iloc_program_create(void);
+
 /**
  * Destroys an ILOC program structure and frees its memory.
  *
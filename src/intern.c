@@ -0,0 +1,171 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "intern.h"
+
+// initial number of slots in the pool hash table; always a power of two
+#define INTERN_INITIAL_CAPACITY 256
+
+
+/**
+ * An interned string, stored right after its precomputed attributes.
+ */
+typedef struct {
+    unsigned int hash;
+    unsigned int id;
+    size_t length;
+    char string[];
+} InternEntry;
+
+/**
+ * The compilation-wide string pool.
+ */
+static struct {
+    /**
+     * An open-addressing hash table of entries.
+     */
+    InternEntry** slots;
+
+    /**
+     * The number of slots in the hash table.
+     */
+    size_t capacity;
+
+    /**
+     * All entries in the order they were interned; entry i has id i + 1.
+     */
+    InternEntry** entries;
+
+    /**
+     * The number of interned strings.
+     */
+    size_t count;
+} pool;
+
+
+/**
+ * Gets the entry that holds an interned string.
+ */
+static inline InternEntry* intern_entry(const char* interned)
+{
+    return (InternEntry*)(interned - offsetof(InternEntry, string));
+}
+
+/**
+ * Computes the FNV-1a hash of a string.
+ */
+static unsigned int intern_compute_hash(const char* string, size_t length)
+{
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char)string[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Doubles the size of the pool hash table and its entry list.
+ */
+static void intern_grow(void)
+{
+    size_t capacity = pool.capacity > 0 ? pool.capacity * 2 : INTERN_INITIAL_CAPACITY;
+    InternEntry** slots = calloc(capacity, sizeof(InternEntry*));
+
+    // put every entry into its slot in the new table
+    for (size_t i = 0; i < pool.count; i++) {
+        size_t slot = pool.entries[i]->hash & (capacity - 1);
+        while (slots[slot] != NULL) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = pool.entries[i];
+    }
+
+    free(pool.slots);
+    pool.slots = slots;
+    pool.capacity = capacity;
+
+    // the pool never gets more than half full, so that's all the entries we need
+    pool.entries = realloc(pool.entries, sizeof(InternEntry*) * (capacity / 2));
+}
+
+/**
+ * Interns a string into the compilation-wide string pool.
+ */
+const char* intern_string(const char* string, size_t length)
+{
+    // keep the table at most half full
+    if (pool.count >= pool.capacity / 2) {
+        intern_grow();
+    }
+
+    // probe for the string or the first empty slot
+    unsigned int hash = intern_compute_hash(string, length);
+    size_t slot = hash & (pool.capacity - 1);
+    while (pool.slots[slot] != NULL) {
+        InternEntry* entry = pool.slots[slot];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->string, string, length) == 0) {
+            return entry->string;
+        }
+        slot = (slot + 1) & (pool.capacity - 1);
+    }
+
+    // not seen before, so make a canonical copy
+    InternEntry* entry = malloc(sizeof(InternEntry) + length + 1);
+    entry->hash = hash;
+    entry->id = pool.count + 1;
+    entry->length = length;
+    memcpy(entry->string, string, length);
+    entry->string[length] = '\0';
+
+    pool.slots[slot] = entry;
+    pool.entries[pool.count++] = entry;
+
+    return entry->string;
+}
+
+/**
+ * Gets the unique id of an interned string.
+ */
+unsigned int intern_id(const char* interned)
+{
+    assert(interned != NULL);
+    return intern_entry(interned)->id;
+}
+
+/**
+ * Gets an interned string by its id.
+ */
+const char* intern_get(unsigned int id)
+{
+    if (id == 0 || id > pool.count) {
+        return NULL;
+    }
+    return pool.entries[id - 1]->string;
+}
+
+/**
+ * Gets the hash of an interned string.
+ */
+unsigned int intern_hash(const char* interned)
+{
+    assert(interned != NULL);
+    return intern_entry(interned)->hash;
+}
+
+/**
+ * Frees all interned strings.
+ */
+void intern_clear(void)
+{
+    for (size_t i = 0; i < pool.count; i++) {
+        free(pool.entries[i]);
+    }
+
+    free(pool.slots);
+    free(pool.entries);
+    pool.slots = NULL;
+    pool.entries = NULL;
+    pool.capacity = 0;
+    pool.count = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef WALRUS_INTERN_H
+#define WALRUS_INTERN_H
+
+#include <stddef.h>
+
+
+/**
+ * Interns a string into the compilation-wide string pool.
+ *
+ * Equal strings are always interned to the same canonical copy, so interned
+ * strings can be compared by pointer instead of by contents. Interned strings
+ * live until intern_clear() is called.
+ *
+ * @param  string The characters of the string; need not be null-terminated.
+ * @param  length The number of characters in the string.
+ * @return        The canonical, null-terminated copy of the string.
+ */
+const char* intern_string(const char* string, size_t length);
+
+/**
+ * Gets the unique id of an interned string.
+ *
+ * Ids are assigned in order starting from 1; 0 is never a valid id.
+ *
+ * @param  interned A string returned by intern_string().
+ * @return          The id of the string.
+ */
+unsigned int intern_id(const char* interned);
+
+/**
+ * Gets an interned string by its id.
+ *
+ * @param  id The id of an interned string.
+ * @return    The interned string, or NULL if no string has the given id.
+ */
+const char* intern_get(unsigned int id);
+
+/**
+ * Gets the hash of an interned string, computed once when it was interned.
+ *
+ * @param  interned A string returned by intern_string().
+ * @return          The hash of the string.
+ */
+unsigned int intern_hash(const char* interned);
+
+/**
+ * Frees all interned strings. Any previously interned strings become invalid.
+ */
+void intern_clear(void);
+
+#endif
@@ -1,30 +1,370 @@
+#include <assert.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "intern.h"
 #include "lexer.h"
 #include "tokens.h"
 
-#define KEYWORD_COUNT 13
+#define KEYWORD_HASH_SIZE 32
+#define KEYWORD_HASH(length, first, last) (((length) * 2 + (first) * 3 + (last)) & (KEYWORD_HASH_SIZE - 1))
 
 
 /**
- * An array of all reserved keywords.
+ * A reserved keyword and the type of token it produces.
  */
-static char* keyword_identifiers[KEYWORD_COUNT] = {
-    "boolean", "break", "callout", "class", "continue", "else", "false", "for",
-    "if", "int", "return", "true", "void"
+typedef struct {
+    const char* keyword;
+    int length;
+    TokenType type;
+} Keyword;
+
+/**
+ * A perfect hash table of all reserved keywords, indexed by KEYWORD_HASH() of
+ * their length and first and last characters. No two keywords share a slot.
+ */
+static const Keyword keyword_table[KEYWORD_HASH_SIZE] = {
+    [KEYWORD_HASH(7, 'b', 'n')] = {"boolean", 7, T_BOOLEAN},
+    [KEYWORD_HASH(5, 'b', 'k')] = {"break", 5, T_BREAK},
+    [KEYWORD_HASH(7, 'c', 't')] = {"callout", 7, T_CALLOUT},
+    [KEYWORD_HASH(5, 'c', 's')] = {"class", 5, T_CLASS},
+    [KEYWORD_HASH(8, 'c', 'e')] = {"continue", 8, T_CONTINUE},
+    [KEYWORD_HASH(4, 'e', 'e')] = {"else", 4, T_ELSE},
+    [KEYWORD_HASH(5, 'f', 'e')] = {"false", 5, T_BOOLEAN_LITERAL},
+    [KEYWORD_HASH(3, 'f', 'r')] = {"for", 3, T_FOR},
+    [KEYWORD_HASH(2, 'i', 'f')] = {"if", 2, T_IF},
+    [KEYWORD_HASH(3, 'i', 't')] = {"int", 3, T_INT},
+    [KEYWORD_HASH(6, 'r', 'n')] = {"return", 6, T_RETURN},
+    [KEYWORD_HASH(4, 't', 'e')] = {"true", 4, T_BOOLEAN_LITERAL},
+    [KEYWORD_HASH(4, 'v', 'd')] = {"void", 4, T_VOID}
 };
 
+
 /**
- * An array of token types that correspond to a keyword by index.
+ * Classes of characters that the lexer distinguishes between.
  */
-static TokenType keyword_token_types[KEYWORD_COUNT] = {
-    T_BOOLEAN, T_BREAK, T_CALLOUT, T_CLASS, T_CONTINUE, T_ELSE, T_BOOLEAN_LITERAL,
-    T_FOR, T_IF, T_INT, T_RETURN, T_BOOLEAN_LITERAL, T_VOID
+typedef enum {
+    CHAR_OTHER = 0,     // anything not allowed outside of literals
+    CHAR_END,           // end of input
+    CHAR_SPACE,         // whitespace other than a line feed
+    CHAR_NEWLINE,       // \n
+    CHAR_SEMICOLON,     // ;
+    CHAR_COMMA,         // ,
+    CHAR_BRACE_LEFT,    // {
+    CHAR_BRACE_RIGHT,   // }
+    CHAR_BRACKET_LEFT,  // [
+    CHAR_BRACKET_RIGHT, // ]
+    CHAR_PAREN_LEFT,    // (
+    CHAR_PAREN_RIGHT,   // )
+    CHAR_SLASH,         // /
+    CHAR_STAR,          // *
+    CHAR_PERCENT,       // %
+    CHAR_PLUS,          // +
+    CHAR_MINUS,         // -
+    CHAR_EQUAL,         // =
+    CHAR_BANG,          // !
+    CHAR_GREATER,       // >
+    CHAR_LESSER,        // <
+    CHAR_AMPERSAND,     // &
+    CHAR_PIPE,          // |
+    CHAR_QUOTE,         // '
+    CHAR_DOUBLE_QUOTE,  // "
+    CHAR_ZERO,          // 0
+    CHAR_DIGIT,         // 1-9
+    CHAR_X,             // x
+    CHAR_HEX_LETTER,    // a-f, A-F
+    CHAR_LETTER,        // any other letter, _
+    CHAR_CLASS_COUNT
+} CharClass;
+
+/**
+ * States of the lexer state machine.
+ *
+ * Every state other than the start state stands for the characters of a token
+ * matched so far.
+ */
+typedef enum {
+    STATE_DONE = 0,     // the current token can't be continued
+    STATE_START,        // between tokens
+    STATE_COMMENT,      // inside of a line comment
+    STATE_SEMICOLON,
+    STATE_COMMA,
+    STATE_BRACE_LEFT,
+    STATE_BRACE_RIGHT,
+    STATE_BRACKET_LEFT,
+    STATE_BRACKET_RIGHT,
+    STATE_PAREN_LEFT,
+    STATE_PAREN_RIGHT,
+    STATE_SLASH,
+    STATE_STAR,
+    STATE_PERCENT,
+    STATE_PLUS,
+    STATE_PLUS_EQUAL,
+    STATE_MINUS,
+    STATE_MINUS_EQUAL,
+    STATE_EQUAL,
+    STATE_IS_EQUAL,
+    STATE_BANG,
+    STATE_IS_NOT_EQUAL,
+    STATE_GREATER,
+    STATE_GREATER_OR_EQUAL,
+    STATE_LESSER,
+    STATE_LESSER_OR_EQUAL,
+    STATE_AMPERSAND,
+    STATE_LOGICAL_AND,
+    STATE_PIPE,
+    STATE_LOGICAL_OR,
+    STATE_CHAR,         // opening quote of a char literal
+    STATE_STRING,       // opening quote of a string literal
+    STATE_IDENTIFIER,
+    STATE_ZERO,         // a zero that could start a hex literal
+    STATE_INT,
+    STATE_HEX_PREFIX,   // 0x without any digits yet
+    STATE_HEX,
+    STATE_UNEXPECTED,   // a character that can't start a token
+    STATE_COUNT
+} LexerState;
+
+/**
+ * Maps every byte value to its character class. Unlisted bytes are CHAR_OTHER.
+ */
+static const unsigned char lexer_char_classes[256] = {
+    [' '] = CHAR_SPACE, ['\t'] = CHAR_SPACE, ['\v'] = CHAR_SPACE, ['\r'] = CHAR_SPACE,
+    ['\n'] = CHAR_NEWLINE,
+    [';'] = CHAR_SEMICOLON, [','] = CHAR_COMMA,
+    ['{'] = CHAR_BRACE_LEFT, ['}'] = CHAR_BRACE_RIGHT,
+    ['['] = CHAR_BRACKET_LEFT, [']'] = CHAR_BRACKET_RIGHT,
+    ['('] = CHAR_PAREN_LEFT, [')'] = CHAR_PAREN_RIGHT,
+    ['/'] = CHAR_SLASH, ['*'] = CHAR_STAR, ['%'] = CHAR_PERCENT,
+    ['+'] = CHAR_PLUS, ['-'] = CHAR_MINUS, ['='] = CHAR_EQUAL, ['!'] = CHAR_BANG,
+    ['>'] = CHAR_GREATER, ['<'] = CHAR_LESSER,
+    ['&'] = CHAR_AMPERSAND, ['|'] = CHAR_PIPE,
+    ['\''] = CHAR_QUOTE, ['"'] = CHAR_DOUBLE_QUOTE,
+    ['0'] = CHAR_ZERO,
+    ['1'] = CHAR_DIGIT, ['2'] = CHAR_DIGIT, ['3'] = CHAR_DIGIT, ['4'] = CHAR_DIGIT, ['5'] = CHAR_DIGIT,
+    ['6'] = CHAR_DIGIT, ['7'] = CHAR_DIGIT, ['8'] = CHAR_DIGIT, ['9'] = CHAR_DIGIT,
+    ['x'] = CHAR_X,
+    ['a'] = CHAR_HEX_LETTER, ['b'] = CHAR_HEX_LETTER, ['c'] = CHAR_HEX_LETTER,
+    ['d'] = CHAR_HEX_LETTER, ['e'] = CHAR_HEX_LETTER, ['f'] = CHAR_HEX_LETTER,
+    ['A'] = CHAR_HEX_LETTER, ['B'] = CHAR_HEX_LETTER, ['C'] = CHAR_HEX_LETTER,
+    ['D'] = CHAR_HEX_LETTER, ['E'] = CHAR_HEX_LETTER, ['F'] = CHAR_HEX_LETTER,
+    ['g'] = CHAR_LETTER, ['h'] = CHAR_LETTER, ['i'] = CHAR_LETTER, ['j'] = CHAR_LETTER,
+    ['k'] = CHAR_LETTER, ['l'] = CHAR_LETTER, ['m'] = CHAR_LETTER, ['n'] = CHAR_LETTER,
+    ['o'] = CHAR_LETTER, ['p'] = CHAR_LETTER, ['q'] = CHAR_LETTER, ['r'] = CHAR_LETTER,
+    ['s'] = CHAR_LETTER, ['t'] = CHAR_LETTER, ['u'] = CHAR_LETTER, ['v'] = CHAR_LETTER,
+    ['w'] = CHAR_LETTER, ['y'] = CHAR_LETTER, ['z'] = CHAR_LETTER,
+    ['G'] = CHAR_LETTER, ['H'] = CHAR_LETTER, ['I'] = CHAR_LETTER, ['J'] = CHAR_LETTER,
+    ['K'] = CHAR_LETTER, ['L'] = CHAR_LETTER, ['M'] = CHAR_LETTER, ['N'] = CHAR_LETTER,
+    ['O'] = CHAR_LETTER, ['P'] = CHAR_LETTER, ['Q'] = CHAR_LETTER, ['R'] = CHAR_LETTER,
+    ['S'] = CHAR_LETTER, ['T'] = CHAR_LETTER, ['U'] = CHAR_LETTER, ['V'] = CHAR_LETTER,
+    ['W'] = CHAR_LETTER, ['X'] = CHAR_LETTER, ['Y'] = CHAR_LETTER, ['Z'] = CHAR_LETTER,
+    ['_'] = CHAR_LETTER
 };
 
+/**
+ * The lexer state transition table, indexed by the current state and the class
+ * of the next character. Unlisted transitions are STATE_DONE.
+ */
+static const unsigned char lexer_transitions[STATE_COUNT][CHAR_CLASS_COUNT] = {
+    [STATE_START] = {
+        [CHAR_OTHER] = STATE_UNEXPECTED,
+        [CHAR_SPACE] = STATE_START,
+        [CHAR_NEWLINE] = STATE_START,
+        [CHAR_SEMICOLON] = STATE_SEMICOLON,
+        [CHAR_COMMA] = STATE_COMMA,
+        [CHAR_BRACE_LEFT] = STATE_BRACE_LEFT,
+        [CHAR_BRACE_RIGHT] = STATE_BRACE_RIGHT,
+        [CHAR_BRACKET_LEFT] = STATE_BRACKET_LEFT,
+        [CHAR_BRACKET_RIGHT] = STATE_BRACKET_RIGHT,
+        [CHAR_PAREN_LEFT] = STATE_PAREN_LEFT,
+        [CHAR_PAREN_RIGHT] = STATE_PAREN_RIGHT,
+        [CHAR_SLASH] = STATE_SLASH,
+        [CHAR_STAR] = STATE_STAR,
+        [CHAR_PERCENT] = STATE_PERCENT,
+        [CHAR_PLUS] = STATE_PLUS,
+        [CHAR_MINUS] = STATE_MINUS,
+        [CHAR_EQUAL] = STATE_EQUAL,
+        [CHAR_BANG] = STATE_BANG,
+        [CHAR_GREATER] = STATE_GREATER,
+        [CHAR_LESSER] = STATE_LESSER,
+        [CHAR_AMPERSAND] = STATE_AMPERSAND,
+        [CHAR_PIPE] = STATE_PIPE,
+        [CHAR_QUOTE] = STATE_CHAR,
+        [CHAR_DOUBLE_QUOTE] = STATE_STRING,
+        [CHAR_ZERO] = STATE_ZERO,
+        [CHAR_DIGIT] = STATE_INT,
+        [CHAR_X] = STATE_IDENTIFIER,
+        [CHAR_HEX_LETTER] = STATE_IDENTIFIER,
+        [CHAR_LETTER] = STATE_IDENTIFIER
+    },
+    [STATE_COMMENT] = {
+        [CHAR_OTHER] = STATE_COMMENT,
+        [CHAR_SPACE] = STATE_COMMENT,
+        [CHAR_NEWLINE] = STATE_START,
+        [CHAR_SEMICOLON] = STATE_COMMENT,
+        [CHAR_COMMA] = STATE_COMMENT,
+        [CHAR_BRACE_LEFT] = STATE_COMMENT,
+        [CHAR_BRACE_RIGHT] = STATE_COMMENT,
+        [CHAR_BRACKET_LEFT] = STATE_COMMENT,
+        [CHAR_BRACKET_RIGHT] = STATE_COMMENT,
+        [CHAR_PAREN_LEFT] = STATE_COMMENT,
+        [CHAR_PAREN_RIGHT] = STATE_COMMENT,
+        [CHAR_SLASH] = STATE_COMMENT,
+        [CHAR_STAR] = STATE_COMMENT,
+        [CHAR_PERCENT] = STATE_COMMENT,
+        [CHAR_PLUS] = STATE_COMMENT,
+        [CHAR_MINUS] = STATE_COMMENT,
+        [CHAR_EQUAL] = STATE_COMMENT,
+        [CHAR_BANG] = STATE_COMMENT,
+        [CHAR_GREATER] = STATE_COMMENT,
+        [CHAR_LESSER] = STATE_COMMENT,
+        [CHAR_AMPERSAND] = STATE_COMMENT,
+        [CHAR_PIPE] = STATE_COMMENT,
+        [CHAR_QUOTE] = STATE_COMMENT,
+        [CHAR_DOUBLE_QUOTE] = STATE_COMMENT,
+        [CHAR_ZERO] = STATE_COMMENT,
+        [CHAR_DIGIT] = STATE_COMMENT,
+        [CHAR_X] = STATE_COMMENT,
+        [CHAR_HEX_LETTER] = STATE_COMMENT,
+        [CHAR_LETTER] = STATE_COMMENT
+    },
+    [STATE_SLASH] = {[CHAR_SLASH] = STATE_COMMENT},
+    [STATE_PLUS] = {[CHAR_EQUAL] = STATE_PLUS_EQUAL},
+    [STATE_MINUS] = {[CHAR_EQUAL] = STATE_MINUS_EQUAL},
+    [STATE_EQUAL] = {[CHAR_EQUAL] = STATE_IS_EQUAL},
+    [STATE_BANG] = {[CHAR_EQUAL] = STATE_IS_NOT_EQUAL},
+    [STATE_GREATER] = {[CHAR_EQUAL] = STATE_GREATER_OR_EQUAL},
+    [STATE_LESSER] = {[CHAR_EQUAL] = STATE_LESSER_OR_EQUAL},
+    [STATE_AMPERSAND] = {[CHAR_AMPERSAND] = STATE_LOGICAL_AND},
+    [STATE_PIPE] = {[CHAR_PIPE] = STATE_LOGICAL_OR},
+    [STATE_IDENTIFIER] = {
+        [CHAR_ZERO] = STATE_IDENTIFIER,
+        [CHAR_DIGIT] = STATE_IDENTIFIER,
+        [CHAR_X] = STATE_IDENTIFIER,
+        [CHAR_HEX_LETTER] = STATE_IDENTIFIER,
+        [CHAR_LETTER] = STATE_IDENTIFIER
+    },
+    [STATE_ZERO] = {
+        [CHAR_ZERO] = STATE_INT,
+        [CHAR_DIGIT] = STATE_INT,
+        [CHAR_X] = STATE_HEX_PREFIX
+    },
+    [STATE_INT] = {
+        [CHAR_ZERO] = STATE_INT,
+        [CHAR_DIGIT] = STATE_INT
+    },
+    [STATE_HEX_PREFIX] = {
+        [CHAR_ZERO] = STATE_HEX,
+        [CHAR_DIGIT] = STATE_HEX,
+        [CHAR_HEX_LETTER] = STATE_HEX
+    },
+    [STATE_HEX] = {
+        [CHAR_ZERO] = STATE_HEX,
+        [CHAR_DIGIT] = STATE_HEX,
+        [CHAR_HEX_LETTER] = STATE_HEX
+    }
+};
+
+/**
+ * The token type matched by each state that matches exactly one token type.
+ */
+static const TokenType lexer_state_tokens[STATE_COUNT] = {
+    [STATE_SEMICOLON] = T_STATEMENT_END,
+    [STATE_COMMA] = T_COMMA,
+    [STATE_BRACE_LEFT] = T_BRACE_LEFT,
+    [STATE_BRACE_RIGHT] = T_BRACE_RIGHT,
+    [STATE_BRACKET_LEFT] = T_BRACKET_LEFT,
+    [STATE_BRACKET_RIGHT] = T_BRACKET_RIGHT,
+    [STATE_PAREN_LEFT] = T_PAREN_LEFT,
+    [STATE_PAREN_RIGHT] = T_PAREN_RIGHT,
+    [STATE_SLASH] = T_DIVIDE,
+    [STATE_STAR] = T_MULTIPLY,
+    [STATE_PERCENT] = T_MODULO,
+    [STATE_PLUS] = T_PLUS,
+    [STATE_PLUS_EQUAL] = T_PLUS_EQUAL,
+    [STATE_MINUS] = T_MINUS,
+    [STATE_MINUS_EQUAL] = T_MINUS_EQUAL,
+    [STATE_EQUAL] = T_EQUAL,
+    [STATE_IS_EQUAL] = T_IS_EQUAL,
+    [STATE_BANG] = T_LOGICAL_NOT,
+    [STATE_IS_NOT_EQUAL] = T_IS_NOT_EQUAL,
+    [STATE_GREATER] = T_IS_GREATER,
+    [STATE_GREATER_OR_EQUAL] = T_IS_GREATER_OR_EQUAL,
+    [STATE_LESSER] = T_IS_LESSER,
+    [STATE_LESSER_OR_EQUAL] = T_IS_LESSER_OR_EQUAL,
+    [STATE_LOGICAL_AND] = T_LOGICAL_AND,
+    [STATE_LOGICAL_OR] = T_LOGICAL_OR,
+    [STATE_ZERO] = T_INT_LITERAL,
+    [STATE_INT] = T_INT_LITERAL,
+    [STATE_HEX] = T_INT_LITERAL
+};
+
+
+/**
+ * Gets the character an escape sequence stands for, given the character after
+ * the backslash, or -1 if it isn't a valid escape.
+ */
+static inline int lexer_escape_char(int modifier)
+{
+    switch (modifier) {
+        case '"':
+            return '"';
+        case '\'':
+            return '\'';
+        case '\\':
+            return '\\';
+        case 't':
+            return '\t';
+        case 'n':
+            return '\n';
+    }
+
+    return -1;
+}
+
+/**
+ * Decodes the lexeme of a string or char literal into the characters it stands
+ * for, without the quotes. Returns the number of characters decoded.
+ *
+ * A literal with an invalid escape in it is lexed as an illegal token, so every
+ * escape that gets here is valid.
+ */
+static size_t lexer_decode_literal(const char* lexeme, size_t length, char* decoded)
+{
+    size_t decoded_length = 0;
+
+    for (size_t i = 1; i + 1 < length; i++) {
+        decoded[decoded_length++] = lexeme[i] == '\\' ? lexer_escape_char(lexeme[++i]) : lexeme[i];
+    }
+
+    return decoded_length;
+}
+
+/**
+ * Interns the name of an identifier token or the contents of a string or char
+ * literal once, so later stages can compare them by pointer and each distinct
+ * literal is stored only once.
+ *
+ * Tokens are only ever interned from one thread, so a single decoding buffer
+ * is enough.
+ */
+static Token lexer_intern_token(ScannerContext* context, Token token)
+{
+    static char decoded[TOKEN_MAX_LENGTH];
+    const char* lexeme = scanner_get_text(context, token.offset);
+
+    if (token.type == T_IDENTIFIER) {
+        token.value = intern_id(intern_string(lexeme, token.length));
+    } else if (token.type == T_STRING_LITERAL || token.type == T_CHAR_LITERAL) {
+        size_t length = lexer_decode_literal(lexeme, token.length, decoded);
+        token.value = intern_id(intern_string(decoded, length));
+    }
+
+    return token;
+}
 
 /**
  * Creates a new stateful lexer instance.
@@ -34,31 +374,265 @@ Lexer* lexer_create(ScannerContext* context)
     Lexer* lexer = (Lexer*)malloc(sizeof(Lexer));
     lexer->context = context;
     lexer->tokens = token_stream_create();
-    lexer->current_node = NULL;
+    lexer->current = -1;
+    lexer->messages = NULL;
+    lexer->message_ends = NULL;
+    lexer->reached = 0;
+    return lexer;
+}
+
+/**
+ * Creates a new lexer that only keeps a small window of recent tokens.
+ */
+Lexer* lexer_create_bounded(ScannerContext* context, int lookahead)
+{
+    Lexer* lexer = lexer_create(context);
+    token_stream_destroy(&lexer->tokens);
+
+    // room for the current token and everything we look ahead at
+    lexer->tokens = token_stream_create_bounded(lookahead + 1);
+    return lexer;
+}
+
+/**
+ * Lexing state for one chunk of a source, lexed on its own thread.
+ */
+typedef struct {
+    /**
+     * A slice of the source covering just this chunk.
+     */
+    ScannerContext* context;
+
+    /**
+     * The tokens read from the chunk.
+     */
+    TokenStream* tokens;
+
+    /**
+     * For each token, the length of the messages printed up to reading it.
+     */
+    size_t* message_ends;
+
+    /**
+     * The messages printed while lexing the chunk.
+     */
+    char* messages;
+    size_t messages_length;
+
+    /**
+     * Indicates if this is the last chunk, which keeps its end-of-file token.
+     */
+    bool last;
+} LexerChunk;
+
+/**
+ * Reads all tokens in a chunk. Runs on a thread of its own.
+ */
+static void* lexer_lex_chunk(void* argument)
+{
+    LexerChunk* chunk = (LexerChunk*)argument;
+    chunk->tokens = token_stream_create();
+    long int message_capacity = chunk->tokens->capacity;
+    chunk->message_ends = malloc(sizeof(size_t) * message_capacity);
+
+    // collect messages so they can be printed in order later
+    FILE* messages = open_memstream(&chunk->messages, &chunk->messages_length);
+    chunk->context->messages = messages;
+
+    while (true) {
+        Token token = lexer_read_token(chunk->context);
+
+        // every chunk but the last ends in the middle of the source
+        if (token.type == T_EOF && !chunk->last) {
+            break;
+        }
+
+        token_stream_push(chunk->tokens, token);
+        if (chunk->tokens->capacity > message_capacity) {
+            message_capacity = chunk->tokens->capacity;
+            chunk->message_ends = realloc(chunk->message_ends, sizeof(size_t) * message_capacity);
+        }
+        chunk->message_ends[chunk->tokens->length - 1] = ftell(messages);
+
+        if (token.type == T_EOF) {
+            break;
+        }
+    }
+
+    fclose(messages);
+    return NULL;
+}
+
+/**
+ * Finds where to end a chunk that should end at or after the given offset.
+ *
+ * A chunk can end right after any line feed that isn't escaped by a backslash.
+ * A line feed always ends a comment, and a string or char literal can only go
+ * on past one if it is escaped, so the lexer is always between tokens there.
+ */
+static long int lexer_find_chunk_end(ScannerContext* context, long int offset)
+{
+    while (offset < context->size) {
+        const char* newline = memchr(context->buffer + offset, '\n', context->size - offset);
+        if (newline == NULL) {
+            break;
+        }
+
+        offset = newline - context->buffer + 1;
+        if (newline == context->buffer || newline[-1] != '\\') {
+            return offset;
+        }
+    }
+
+    return context->size;
+}
+
+/**
+ * Creates a new lexer that lexes the whole source up front, in parallel.
+ */
+Lexer* lexer_create_parallel(ScannerContext* context, int threads)
+{
+    Lexer* lexer = lexer_create(context);
+
+    // only sources that are already in memory can be split up
+    if (threads < 2 || context->fd >= 0) {
+        return lexer;
+    }
+
+    // split the source into roughly equal chunks at safe line feeds
+    LexerChunk* chunks = calloc(threads, sizeof(LexerChunk));
+    int chunk_count = 0;
+    long int start = context->position;
+    while (start < context->size || chunk_count == 0) {
+        long int target = start + (context->size - start) / (threads - chunk_count);
+        long int end = chunk_count == threads - 1 ? context->size : lexer_find_chunk_end(context, target);
+
+        chunks[chunk_count].context = scanner_open_slice(context, start, end);
+        chunks[chunk_count].last = end == context->size;
+        chunk_count++;
+        start = end;
+    }
+
+    // lex all chunks at once
+    pthread_t* workers = malloc(sizeof(pthread_t) * chunk_count);
+    for (int i = 0; i < chunk_count; i++) {
+        pthread_create(&workers[i], NULL, lexer_lex_chunk, &chunks[i]);
+    }
+    for (int i = 0; i < chunk_count; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+
+    // the whole source has been read now
+    context->position = context->size;
+    context->eof = true;
+
+    // stitch the chunks back together in order
+    size_t messages_length = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        messages_length += chunks[i].messages_length;
+    }
+    lexer->messages = malloc(messages_length + 1);
+
+    long int token_count = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        token_count += chunks[i].tokens->length;
+    }
+    lexer->message_ends = malloc(sizeof(size_t) * (token_count + 1));
+
+    size_t message_base = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        LexerChunk* chunk = &chunks[i];
+
+        for (long int j = 0; j < chunk->tokens->length; j++) {
+            token_stream_push(lexer->tokens, lexer_intern_token(context, token_stream_get(chunk->tokens, j)));
+            lexer->message_ends[lexer->tokens->length - 1] = message_base + chunk->message_ends[j];
+        }
+
+        memcpy(lexer->messages + message_base, chunk->messages, chunk->messages_length);
+        message_base += chunk->messages_length;
+
+        scanner_close(&chunk->context);
+        token_stream_destroy(&chunk->tokens);
+        free(chunk->message_ends);
+        free(chunk->messages);
+    }
+    free(chunks);
+
     return lexer;
 }
 
+/**
+ * Reads tokens into the token stream until it has a token at the given index,
+ * or until the end-of-file has been read.
+ */
+static void lexer_fill(Lexer* lexer, long int index)
+{
+    TokenStream* tokens = lexer->tokens;
+
+    // tokens lexed up front are all there; just print their messages the
+    // first time they are reached, as if they were being read now
+    if (lexer->messages != NULL) {
+        while (lexer->reached <= index && lexer->reached < tokens->length) {
+            size_t start = lexer->reached > 0 ? lexer->message_ends[lexer->reached - 1] : 0;
+            fwrite(lexer->messages + start, 1, lexer->message_ends[lexer->reached] - start, lexer->context->messages);
+            lexer->reached++;
+        }
+        return;
+    }
+
+    while (tokens->length <= index
+        && (tokens->length == 0 || token_stream_get(tokens, tokens->length - 1).type != T_EOF)) {
+        token_stream_push(tokens, lexer_intern_token(lexer->context, lexer_read_token(lexer->context)));
+    }
+    lexer->reached = tokens->length;
+
+    // a bounded lexer never goes back past the oldest token in its window, so
+    // the source before it can go
+    if (tokens->bounded) {
+        scanner_release(lexer->context, token_stream_get(tokens, token_stream_first(tokens)).offset);
+    }
+}
+
+/**
+ * Gets the token at the given index, reading more tokens only if it hasn't
+ * been reached yet. Indexes past the end-of-file get the end-of-file token.
+ */
+static inline Token lexer_get(Lexer* lexer, long int index)
+{
+    // tokens in the window are a plain array read
+    if (index >= lexer->reached) {
+        lexer_fill(lexer, index);
+        if (index >= lexer->reached) {
+            index = lexer->reached - 1;
+        }
+    }
+
+    return token_stream_get(lexer->tokens, index);
+}
+
 /**
  * Gets the next token from a lexer and advances forward one token.
  */
 Token lexer_next(Lexer* lexer)
 {
-    // check if we are at the tail of the stream
-    if (lexer->current_node == lexer->tokens->tail) {
-        // only read another token if we haven't reached the end-of-file
-        if (lexer->current_node == NULL || lexer->current_node->token.type != T_EOF) {
-            // read another token
-            Token token = lexer_read_token(lexer->context);
-            token_stream_push(lexer->tokens, token);
-            lexer->current_node = lexer->tokens->tail;
-        }
-    } else {
-        // we aren't at the tail, so move forward in the stream
-        lexer->current_node = lexer->current_node->next;
+    // make sure the next token has been read
+    Token token = lexer_get(lexer, lexer->current + 1);
+
+    // move forward unless we are already at the end-of-file
+    if (lexer->current + 1 < lexer->reached) {
+        lexer->current++;
     }
 
-    // return the current token
-    return lexer->current_node->token;
+    return token;
+}
+
+/**
+ * Gets the current token of a lexer.
+ */
+Token lexer_current(Lexer* lexer)
+{
+    return token_stream_get(lexer->tokens, lexer->current);
 }
 
 /**
@@ -71,13 +645,14 @@ Error lexer_backtrack(Lexer* lexer)
         return E_BAD_POINTER;
     }
 
-    // can't backtrack if no tokens have been read or we are at the beginning
-    if (lexer->current_node == NULL || lexer->current_node->previous == NULL) {
+    // can't backtrack if no tokens have been read, we are at the beginning or
+    // the previous token has already been dropped from the window
+    if (lexer->current <= token_stream_first(lexer->tokens)) {
         return E_OPERATION_FAILED;
     }
 
     // move backwards
-    lexer->current_node = lexer->current_node->previous;
+    lexer->current--;
     return E_SUCCESS;
 }
 
@@ -86,24 +661,10 @@ Error lexer_backtrack(Lexer* lexer)
  */
 Token lexer_lookahead(Lexer* lexer, int count)
 {
-    // advance by the given count and capture the token
-    Token token;
-    for (int i = 0; i < count; i++) {
-        token = lexer_next(lexer);
-
-        // handle lookahead over the end-of-file
-        if (token.type == T_EOF) {
-            count = i + 1;
-            break;
-        }
-    }
-
-    // retreat back to previous token
-    for (int i = 0; i < count; i++) {
-        lexer_backtrack(lexer);
-    }
+    // a bounded lexer must not push the current token out of its window
+    assert(!lexer->tokens->bounded || count < lexer->tokens->capacity);
 
-    return token;
+    return lexer_get(lexer, lexer->current + count);
 }
 
 /**
@@ -120,6 +681,10 @@ Error lexer_destroy(Lexer** lexer)
     token_stream_destroy(&((**lexer).tokens)); // dereference lexer twice, access
                                                // tokens, and get its address
 
+    // free any messages from lexing up front
+    free((*lexer)->messages);
+    free((*lexer)->message_ends);
+
     // free memory for lexer
     free(*lexer);
     *lexer = NULL;
@@ -128,267 +693,151 @@ Error lexer_destroy(Lexer** lexer)
 }
 
 /**
- * Shorthand for creating a token at the current scanner position.
+ * Prints the file name and current position of a scanner for a lexer message.
  */
-static inline Token lexer_create_token(ScannerContext* context, TokenType type, char* lexeme)
+static void lexer_print_location(ScannerContext* context)
 {
-    return token_create(
-        context->file,
-        context->line,
-        context->column,
-        type,
-        lexeme
-    );
+    unsigned int line, column;
+    scanner_locate(context, context->position, &line, &column);
+    fprintf(context->messages, "%s line %d:%d: ", basename(context->file), line, column);
+}
+
+/**
+ * Shorthand for creating a token at the current scanner position, whose lexeme
+ * is the given number of characters just before the current position.
+ */
+static inline Token lexer_create_token(ScannerContext* context, TokenType type, long int length)
+{
+    // the lexeme can't start before the beginning of the source
+    if (length > context->position) {
+        length = context->position;
+    }
+
+    // tokens can only refer to lexemes of limited length
+    if (length > TOKEN_MAX_LENGTH) {
+        lexer_print_location(context);
+        fprintf(context->messages, "token too long\n");
+        type = T_ILLEGAL;
+        length = TOKEN_MAX_LENGTH;
+    }
+
+    return token_create(context->id, type, context->position - length, length);
 }
 
 /**
  * Reads the next token from a scanner context.
+ *
+ * Runs the lexer state machine one character at a time: each character is
+ * classified and looked up in the transition table until the current state
+ * can't be continued, at which point the state determines the token.
  */
 Token lexer_read_token(ScannerContext* context)
 {
-    // the current character
-    char character;
+    LexerState state = STATE_START;
+    long int length = 0;
 
-    // attempt to match a token until a non-whitespace token is found
+    // jump over whitespace and comments in bulk before running the machine
     while (true) {
-        // get the next char from the scanner
-        character = scanner_next(context);
-
-        // try to match normal whitespace to skip it
-        if (isspace(character) && character != 0xC) {
-            continue;
+        scanner_skip_whitespace(context);
+        if (scanner_peek(context, 0) != '/' || scanner_peek(context, 1) != '/') {
+            break;
         }
+        scanner_skip_line(context);
+    }
 
-        // branch into attempts at matching different token types
-        switch (character) {
-            // end of file
-            case EOF:
-                return lexer_create_token(context, T_EOF, "EOF");
-
-            // simple single-character tokens
-            case ';':
-                return lexer_create_token(context, T_STATEMENT_END, ";");
-
-            case ',':
-                return lexer_create_token(context, T_COMMA, ",");
-
-            case '{':
-                return lexer_create_token(context, T_BRACE_LEFT, "{");
-
-            case '}':
-                return lexer_create_token(context, T_BRACE_RIGHT, "}");
-
-            case '[':
-                return lexer_create_token(context, T_BRACKET_LEFT, "[");
-
-            case ']':
-                return lexer_create_token(context, T_BRACKET_RIGHT, "]");
-
-            case '(':
-                return lexer_create_token(context, T_PAREN_LEFT, "(");
-
-            case ')':
-                return lexer_create_token(context, T_PAREN_RIGHT, ")");
-
-            // / //
-            case '/':
-                // comment line?
-                if (scanner_peek(context, 0) == '/') {
-                    while (!context->eol && !context->eof) {
-                        scanner_next(context);
-                    }
-                    continue;
-                }
-                return lexer_create_token(context, T_DIVIDE, "/");
-
-            // single-character operators ;)
-            case '*':
-                return lexer_create_token(context, T_MULTIPLY, "*");
-
-            case '%':
-                return lexer_create_token(context, T_MODULO, "%");
-
-            // + +=
-            case '+':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_PLUS_EQUAL, "+=");
-                }
-                return lexer_create_token(context, T_PLUS, "+");
-
-            // - -=
-            case '-':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_MINUS, "-=");
-                }
-                return lexer_create_token(context, T_MINUS, "-");
-
-            // = ==
-            case '=':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_IS_EQUAL, "==");
-                }
-                return lexer_create_token(context, T_EQUAL, "=");
-
-            // ! !=
-            case '!':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_IS_NOT_EQUAL, "!=");
-                }
-                return lexer_create_token(context, T_LOGICAL_NOT, "!");
-
-            // > >=
-            case '>':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_IS_GREATER_OR_EQUAL, ">=");
-                }
-                return lexer_create_token(context, T_IS_GREATER, ">");
-
-            // < <=
-            case '<':
-                // check next token to see if it's an equal sign
-                if (scanner_peek(context, 0) == '=') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_IS_LESSER_OR_EQUAL, "<=");
-                }
-                return lexer_create_token(context, T_IS_LESSER, "<");
-
-            // &&
-            case '&':
-                if (scanner_peek(context, 0) == '&') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_LOGICAL_AND, "&&");
-                }
-                // nothing else starts with &
-
-            // ||
-            case '|':
-                if (scanner_peek(context, 0) == '|') {
-                    scanner_advance(context, 1);
-                    return lexer_create_token(context, T_LOGICAL_OR, "||");
-                }
-                // nothing else starts with |
-
-            // looks like the beginning of a char
-            case '\'':
-                return lexer_lex_char(context);
-
-            // looks like the beginning of a string
-            case '\"':
-                return lexer_lex_string(context);
+    while (true) {
+        // classify the next character without consuming it
+        CharClass class = context->eof || (context->position >= context->size && !scanner_fill(context, 1))
+            ? CHAR_END
+            : lexer_char_classes[(unsigned char)*scanner_get_text(context, context->position)];
+
+        // stop if the current token can't be continued
+        LexerState next = lexer_transitions[state][class];
+        if (next == STATE_DONE) {
+            break;
         }
 
-        // nothing matched so far, try variable matching
-        // looks like the start of an identifier
-        if (isalpha(character) || character == '_') {
-            return lexer_lex_identifier(context);
-        }
+        // consume the character; going back to the start state means we
+        // skipped whitespace or a comment
+        scanner_next(context);
+        length = next == STATE_START ? 0 : length + 1;
+        state = next;
+    }
 
-        // start of an int literal
-        if (isdigit(character)) {
-            return lexer_lex_int(context);
-        }
+    switch (state) {
+        // end of file
+        case STATE_START:
+        case STATE_COMMENT:
+            return lexer_create_token(context, T_EOF, 0);
 
-        // we tried everything, lets call it a day
-        lexer_error(context, character, -1);
-        return lexer_create_token(
-            context,
-            T_ILLEGAL,
-            scanner_get_string(context, -1)
-        );
-    }
-}
+        // looks like the beginning of a char
+        case STATE_CHAR:
+            return lexer_lex_char(context);
 
-/**
- * Reads an identifier token in the current context.
- */
-Token lexer_lex_identifier(ScannerContext* context)
-{
-    // continuously peek then advance by one until a non-alphanumeric character is found
-    for (int length = 1; !context->eof; length++) {
-        // peek ahead at the next char
-        char c = scanner_peek(context, 0);
-
-        // is the next character the end of the identifier?
-        if (!isalnum(c) && c != '_') {
-            // get the entire identifier string
-            char* identifier = scanner_get_string(context, 0 - length);
-
-            // check if the identifier is a keyword
-            if (lexer_identifier_is_keyword(identifier)) {
-                // return a keyword token instead
-                return lexer_create_keyword_token(identifier, context);
-            }
+        // looks like the beginning of a string
+        case STATE_STRING:
+            return lexer_lex_string(context);
 
-            // valid, non keyword identifier - create a token
-            return lexer_create_token(context, T_IDENTIFIER, identifier);
+        // identifiers might be keywords
+        case STATE_IDENTIFIER: {
+            const char* identifier = scanner_get_text(context, context->position - length);
+            return lexer_create_token(context, lexer_keyword_type(identifier, length), length);
         }
 
-        // consume the peeked char
-        scanner_advance(context, 1);
+        // work out int literal values now so they are never parsed again
+        case STATE_ZERO:
+        case STATE_INT:
+        case STATE_HEX:
+            return lexer_lex_int(context, length);
+
+        // a hex literal needs at least one digit after the 0x
+        case STATE_HEX_PREFIX:
+            lexer_error(context, scanner_next(context), -1);
+            return lexer_create_token(context, T_ILLEGAL, length);
+
+        // we tried everything, lets call it a day
+        case STATE_AMPERSAND:
+        case STATE_PIPE:
+        case STATE_UNEXPECTED:
+            lexer_error(context, (unsigned char)*scanner_get_text(context, context->position - 1), -1);
+            return lexer_create_token(context, T_ILLEGAL, 1);
     }
+
+    // every other state matches exactly one token type
+    return lexer_create_token(context, lexer_state_tokens[state], length);
 }
 
 /**
- * Reads an int literal token in the current context.
+ * Creates an int literal token from the digits just read and computes its value.
  */
-Token lexer_lex_int(ScannerContext* context)
+Token lexer_lex_int(ScannerContext* context, long int length)
 {
-    bool hexadecimal = false;
-    int length = 1; // we already consumed the first digit
-
-    // is it the start of a hex literal?
-    if (scanner_peek(context, 0) == 'x' && scanner_peek(context, -1) == '0') {
-        hexadecimal = true;
-        scanner_advance(context, 1);
-        length++;
+    Token token = lexer_create_token(context, T_INT_LITERAL, length);
+    if (token.type != T_INT_LITERAL) {
+        return token;
     }
 
-    // consume chars until we hit a non-int character
-    while (true) {
-        // peek ahead
-        char c = scanner_peek(context, 0);
-
-        // is it a digit?
-        if (!isdigit(c)) {
-            // it's OK if it is hexadecimal
-            if (!hexadecimal || strchr("ABCDEFabcdef", c) == NULL) {
-                // nvm, not even OK for hexadecimal
-                break;
-            }
+    const char* digit = scanner_get_text(context, token.offset);
+    const char* end = digit + token.length;
+    bool hex = token.length > 2 && digit[1] == 'x';
+    uint64_t value = 0;
+
+    // accumulate in 64 bits and stop as soon as the value is out of range
+    for (digit += hex ? 2 : 0; digit < end; digit++) {
+        if (hex) {
+            value = value * 16 + (*digit <= '9' ? *digit - '0' : (*digit | 0x20) - 'a' + 10);
+        } else {
+            value = value * 10 + (*digit - '0');
         }
 
-        // move ahead 1 char
-        scanner_advance(context, 1);
-        length++;
-    }
-
-    // check to make sure that a hex string is at least 3 characters long
-    if (hexadecimal && length <= 2) {
-        lexer_error(context, scanner_next(context), -1);
-
-        return lexer_create_token(
-            context,
-            T_ILLEGAL,
-            scanner_get_string(context, 0 - length)
-        );
+        if (value > TOKEN_INT_MAX) {
+            token.overflow = true;
+            return token;
+        }
     }
 
-    // we made it! return the token
-    return lexer_create_token(
-        context,
-        T_INT_LITERAL,
-        scanner_get_string(context, 0 - length)
-    );
+    token.value = (uint32_t)value;
+    return token;
 }
 
 /**
@@ -397,7 +846,7 @@ Token lexer_lex_int(ScannerContext* context)
 Token lexer_lex_char(ScannerContext* context)
 {
     // get the actual character in the char literal
-    char character = scanner_next(context);
+    int character = scanner_next(context);
 
     // char is escaped
     bool is_escaped = false;
@@ -410,7 +859,7 @@ Token lexer_lex_char(ScannerContext* context)
             return lexer_create_token(
                 context,
                 T_ILLEGAL,
-                scanner_get_string(context, -2)
+                2
             );
         }
     }
@@ -421,7 +870,7 @@ Token lexer_lex_char(ScannerContext* context)
         return lexer_create_token(
             context,
             T_ILLEGAL,
-            scanner_get_string(context, -2)
+            2
         );
     }
 
@@ -432,7 +881,7 @@ Token lexer_lex_char(ScannerContext* context)
         return lexer_create_token(
             context,
             T_ILLEGAL,
-            scanner_get_string(context, -2)
+            2
         );
     }
 
@@ -440,7 +889,7 @@ Token lexer_lex_char(ScannerContext* context)
     return lexer_create_token(
         context,
         T_CHAR_LITERAL,
-        scanner_get_string(context, is_escaped ? -4 : -3)
+        is_escaped ? 4 : 3
     );
 }
 
@@ -449,8 +898,9 @@ Token lexer_lex_char(ScannerContext* context)
  */
 Token lexer_lex_string(ScannerContext* context)
 {
-    char character;
+    int character;
     int length = 0; // length of string
+    bool valid = true;
 
     // consumes next char until end of string or file
     while (!context->eof) {
@@ -465,7 +915,11 @@ Token lexer_lex_string(ScannerContext* context)
 
         // char is escaped
         if (character == '\\') {
-            character = lexer_scan_escaped(context);
+            // keep going to the closing quote, so the rest of the string isn't
+            // read as code
+            if (lexer_scan_escaped(context) < 0) {
+                valid = false;
+            }
             length++;
         }
 
@@ -475,79 +929,76 @@ Token lexer_lex_string(ScannerContext* context)
             return lexer_create_token(
                 context,
                 T_ILLEGAL,
-                scanner_get_string(context, -1 - length)
+                1 + length
             );
         }
 
     }
 
-    // we made it this far; must be OK
+    // we made it this far; must be OK unless an escape was invalid
     return lexer_create_token(
         context,
-        T_STRING_LITERAL,
-        scanner_get_string(context, -2 - length)
+        valid ? T_STRING_LITERAL : T_ILLEGAL,
+        2 + length
     );
 }
 
 /**
  * Scans an escaped character and returns the actual character, or -1 if the char is invalid.
  */
-char lexer_scan_escaped(ScannerContext* context)
+int lexer_scan_escaped(ScannerContext* context)
 {
-    char escape_modifier = scanner_next(context);
+    int escape_modifier = scanner_next(context);
+    int character = lexer_escape_char(escape_modifier);
 
-    switch (escape_modifier) {
-        case '"':
-            return '"';
-        case '\'':
-            return '\'';
-        case '\\':
-            return '\\';
-        case 't':
-            return '\t';
-        case 'n':
-            return '\n';
+    if (character < 0) {
+        lexer_error(context, escape_modifier, -1);
     }
-
-    lexer_error(context, escape_modifier, -1);
-    return -1;
+    return character;
 }
 
 /**
- * Checks to see if the input string is a reserved keyword.
+ * Gets the token type of an identifier, which is a keyword type if the
+ * identifier is a reserved keyword.
  */
-bool lexer_identifier_is_keyword(char* identifier)
+TokenType lexer_keyword_type(const char* identifier, int length)
 {
-    // loop over all keywords for a match
-    for (int i = 0; i < KEYWORD_COUNT; i++) {
-        if (strcmp(identifier, keyword_identifiers[i]) == 0) {
-            return true;
-        }
+    // identifiers are never empty, so the first and last chars always exist
+    unsigned char first = identifier[0];
+    unsigned char last = identifier[length - 1];
+
+    // the only keyword that could possibly match lives in this slot
+    const Keyword* keyword = &keyword_table[KEYWORD_HASH(length, first, last)];
+    if (keyword->length == length && memcmp(identifier, keyword->keyword, length) == 0) {
+        return keyword->type;
     }
-    return false;
+
+    return T_IDENTIFIER;
 }
 
 /**
- * Creates a token based on the passed in keyword.
+ * Copies the lexeme of a token into a newly allocated string.
  */
-Token lexer_create_keyword_token(char* keyword, ScannerContext* context)
+char* lexer_token_string(Lexer* lexer, Token token)
 {
-    // loop over all keywords for a match
-    for (int i = 0; i < KEYWORD_COUNT; i++) {
-        if (strcmp(keyword, keyword_identifiers[i]) == 0) {
-            return lexer_create_token(context, keyword_token_types[i], keyword);
-        }
-    }
+    return scanner_get_slice(lexer->context, token.offset, token.length);
+}
 
-    return lexer_create_token(context, T_ILLEGAL, keyword);
+/**
+ * Checks if the lexeme of a token is equal to a given string.
+ */
+bool lexer_token_matches(Lexer* lexer, Token token, const char* string)
+{
+    return strncmp(scanner_get_text(lexer->context, token.offset), string, token.length) == 0
+        && string[token.length] == '\0';
 }
 
 /**
  * Prints a token to standard output.
  */
-void lexer_print_token(Token token)
+void lexer_print_token(Lexer* lexer, Token token)
 {
-    printf("%d ", token.line);
+    printf("%d ", token_line(token));
 
     if (token.type == T_BOOLEAN_LITERAL) {
         printf("BOOLEANLITERAL ");
@@ -563,17 +1014,19 @@ void lexer_print_token(Token token)
         printf("ILLEGAL ");
     }
 
-    printf("%s\n", token.lexeme);
+    printf("%.*s\n", token.length, scanner_get_text(lexer->context, token.offset));
 }
 
 /**
  * Turns a character into a printable string.
  */
-char* lexer_char_printable(char character, bool quoted)
+char* lexer_char_printable(int character, bool quoted)
 {
     char* string = malloc(sizeof(char) * 6);
 
-    if (quoted && character == '\\') {
+    if (character == EOF) {
+        strcpy(string, "EOF");
+    } else if (quoted && character == '\\') {
         strcpy(string, "'\\\\'");
     } else if (quoted && character == '\t') {
         strcpy(string, "'\\t'");
@@ -591,13 +1044,13 @@ char* lexer_char_printable(char character, bool quoted)
 /**
  * Displays an error message for an invalid character.
  */
-void lexer_error(ScannerContext* context, char unexpected, char expected)
+void lexer_error(ScannerContext* context, int unexpected, int expected)
 {
-    printf("%s line %d:%d: ", basename(context->file), context->line, context->column);
+    lexer_print_location(context);
 
     if (expected >= 0) {
-        printf("expecting %s, found %s\n", lexer_char_printable(expected, true), lexer_char_printable(unexpected, true));
+        fprintf(context->messages, "expecting %s, found %s\n", lexer_char_printable(expected, true), lexer_char_printable(unexpected, true));
     } else {
-        printf("unexpected char: %s\n", lexer_char_printable(unexpected, false));
+        fprintf(context->messages, "unexpected char: %s\n", lexer_char_printable(unexpected, false));
     }
 }
@@ -1,6 +1,7 @@
 #ifndef WALRUS_LEXER_H
 #define WALRUS_LEXER_H
 
+#include <stddef.h>
 #include "tokens.h"
 #include "scanner.h"
 
@@ -20,9 +21,29 @@ typedef struct {
     TokenStream* tokens;
 
     /**
-     * A pointer to the current position in the token stream.
+     * The index of the current token in the token stream, or -1 if no tokens
+     * have been read yet.
      */
-    TokenStreamNode* current_node;
+    long int current;
+
+    /**
+     * Messages printed while lexing the source up front, or NULL if tokens are
+     * read as they are needed.
+     */
+    char* messages;
+
+    /**
+     * For each token lexed up front, the length of the messages printed up to
+     * reading it.
+     */
+    size_t* message_ends;
+
+    /**
+     * The number of tokens that have been handed out so far. Lexer messages
+     * for these tokens have been printed, so they can be read straight from
+     * the token stream.
+     */
+    long int reached;
 } Lexer;
 
 /**
@@ -33,6 +54,35 @@ typedef struct {
  */
 Lexer* lexer_create(ScannerContext* context);
 
+/**
+ * Creates a new stateful lexer instance that only keeps the current token and
+ * a few tokens around it, and lets the scanner drop the source behind them, so
+ * only the interned names grow with the input size.
+ *
+ * The lexer can look ahead at least the given number of tokens. Backtracking
+ * fails once the previous token has been dropped from the window.
+ *
+ * @param  context   The scanner that the lexer should read from.
+ * @param  lookahead The maximum number of tokens the lexer will look ahead.
+ * @return           A new stateful lexer that can read tokens.
+ */
+Lexer* lexer_create_bounded(ScannerContext* context, int lookahead);
+
+/**
+ * Creates a new stateful lexer instance that lexes the whole source up front,
+ * splitting it into chunks that are lexed on separate threads.
+ *
+ * Tokens and lexer messages come out exactly as from a lexer that reads tokens
+ * one at a time; messages are held back until the token they belong to is
+ * read. Sources that are not yet entirely in memory are lexed one token at a
+ * time instead.
+ *
+ * @param  context The scanner that the lexer should read from.
+ * @param  threads The number of threads to lex with.
+ * @return         A new stateful lexer that can read tokens.
+ */
+Lexer* lexer_create_parallel(ScannerContext* context, int threads);
+
 /**
  * Gets the next token from a lexer and advances forward one token.
  *
@@ -41,11 +91,21 @@ Lexer* lexer_create(ScannerContext* context);
  */
 Token lexer_next(Lexer* lexer);
 
+/**
+ * Gets the current token of a lexer, which is the token most recently returned
+ * by lexer_next().
+ *
+ * @param  lexer The lexer context.
+ * @return       The current token.
+ */
+Token lexer_current(Lexer* lexer);
+
 /**
  * Backtracks a lexer by one token.
  *
  * @param  lexer The lexer to backtrack.
- * @return       An error code.
+ * @return       An error code; E_OPERATION_FAILED if there is no previous token
+ *               to go back to.
  */
 Error lexer_backtrack(Lexer* lexer);
 
@@ -53,7 +113,8 @@ Error lexer_backtrack(Lexer* lexer);
  * Looks ahead a given number of tokens.
  *
  * @param  lexer The lexer to look ahead in.
- * @param  count The number of tokens ahead to look.
+ * @param  count The number of tokens ahead to look; for a bounded lexer, no
+ *               more than the lookahead it was created with.
  * @return       A token parsed from the scanner input.
  */
 Token lexer_lookahead(Lexer* lexer, int count);
@@ -78,20 +139,14 @@ Error lexer_destroy(Lexer** lexer);
 Token lexer_read_token(ScannerContext* context);
 
 /**
- * Reads an identifier token in the current context.
+ * Creates an int literal token from the decimal or hex digits just read, and
+ * computes its value.
  *
  * @param  context The scanner context to read from.
- * @return         A matched char token, or an illegal token.
+ * @param  length  The number of characters in the literal.
+ * @return         An int literal token, flagged if its value is out of range.
  */
-Token lexer_lex_identifier(ScannerContext* context);
-
-/**
- * Reads an integer literal token in the current context.
- *
- * @param  context The scanner context to read from.
- * @return         A matched integer token, or an illegal token.
- */
-Token lexer_lex_int(ScannerContext* context);
+Token lexer_lex_int(ScannerContext* context, long int length);
 
 /**
  * Reads a char token in the current context.
@@ -115,38 +170,56 @@ Token lexer_lex_string(ScannerContext* context);
  * @param  context The scanner context to read from.
  * @return         The escaped character.
  */
-char lexer_scan_escaped(ScannerContext* context);
+int lexer_scan_escaped(ScannerContext* context);
 
 /**
- * Checks to see if an identifier string is a reserved keyword.
+ * Gets the token type of an identifier with a single perfect hash lookup.
  *
  * @param  identifier The identifier string to check.
- * @return            True if the given identifier is a keyword, otherwise false.
+ * @param  length     The length of the identifier string; must be at least 1.
+ * @return            The keyword token type if the identifier is a reserved
+ *                    keyword, otherwise T_IDENTIFIER.
+ */
+TokenType lexer_keyword_type(const char* identifier, int length);
+
+/**
+ * Copies the lexeme of a token into a newly allocated string.
+ *
+ * Tokens only refer to their text in the source, so use this when a real string
+ * is needed.
+ *
+ * @param  lexer The lexer the token was read from.
+ * @param  token The token.
+ * @return       The token lexeme as a string.
  */
-bool lexer_identifier_is_keyword(char* identifier);
+char* lexer_token_string(Lexer* lexer, Token token);
 
 /**
- * Creates a token based on the passed in keyword.
+ * Checks if the lexeme of a token is equal to a given string.
  *
- * @param  keyword The input keyword.
- * @param  context The current context of the scanner.
- * @return         A token for the given keyword.
+ * @param  lexer  The lexer the token was read from.
+ * @param  token  The token.
+ * @param  string The string to compare with.
+ * @return        True if the lexeme and the string are equal, otherwise false.
  */
-Token lexer_create_keyword_token(char* keyword, ScannerContext* context);
+bool lexer_token_matches(Lexer* lexer, Token token, const char* string);
 
 /**
  * Prints a token to standard output.
  *
- * @param tokens A token to print.
+ * @param lexer The lexer the token was read from.
+ * @param token A token to print.
  */
-void lexer_print_token(Token);
+void lexer_print_token(Lexer* lexer, Token token);
 
 /**
  * Displays an error message for lexing errors.
  *
- * @param message The error message.
- * @param context The scanner context the error occurred at.
+ * @param context    The scanner context the error occurred at.
+ * @param unexpected The character found, as an unsigned char, or EOF.
+ * @param expected   The character expected, or -1 if there is no one character
+ *                   that would have been right.
  */
-void lexer_error(ScannerContext* context, char unexpected, char expected);
+void lexer_error(ScannerContext* context, int unexpected, int expected);
 
 #endif
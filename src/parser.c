@@ -1,22 +1,75 @@
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ast.h"
 #include "error.h"
+#include "intern.h"
 #include "lexer.h"
 #include "parser.h"
 #include "symbol_table.h"
 
 
+/**
+ * Tokens that end or start a statement, from FOLLOW(<statement>) and
+ * FIRST(<statement>) in docs/parser/first-and-follow-sets.md. Identifiers,
+ * callout and ( are left out because they also show up inside expressions.
+ */
+static const bool parser_statement_sync[T_WHITESPACE + 1] = {
+    [T_STATEMENT_END] = true,
+    [T_IF] = true,
+    [T_FOR] = true,
+    [T_RETURN] = true,
+    [T_BREAK] = true,
+    [T_CONTINUE] = true,
+    [T_BRACE_LEFT] = true,
+    [T_BRACE_RIGHT] = true,
+    [T_EOF] = true
+};
+
+/**
+ * Tokens that end or start a class member, from FOLLOW(<field_decl>) and
+ * FIRST(<method_decl>), plus the } that ends the class.
+ */
+static const bool parser_member_sync[T_WHITESPACE + 1] = {
+    [T_STATEMENT_END] = true,
+    [T_BOOLEAN] = true,
+    [T_INT] = true,
+    [T_VOID] = true,
+    [T_BRACE_RIGHT] = true,
+    [T_EOF] = true
+};
+
+/**
+ * Set after a syntax error is reported until the parser gets back in sync, so
+ * that one mistake is only reported once.
+ */
+static bool parser_panicking = false;
+
+/**
+ * The number of syntax errors reported while parsing the current file.
+ */
+static int parser_error_count = 0;
+
+/**
+ * The arena nodes of the tree being parsed are allocated from.
+ */
+static Arena* parser_arena = NULL;
+
+
 /**
  * Parses the tokens yielded by a given lexer.
  */
-ASTNode* parser_parse(Lexer* lexer)
+ASTNode* parser_parse(Lexer* lexer, Arena* arena)
 {
+    parser_arena = arena;
+    parser_panicking = false;
+    parser_error_count = 0;
+
     // the source file should contain a single program (duh!)
     ASTDecl* node;
-    if (parser_parse_program(lexer, &node) != E_SUCCESS) {
+    if (parser_parse_program(lexer, &node) != E_SUCCESS || parser_error_count > 0) {
         error(E_PARSE_ERROR, "Failed to parse file \"%s\".", lexer->context->file);
     }
 
@@ -28,64 +81,153 @@ ASTNode* parser_parse(Lexer* lexer)
  */
 Error parser_error(Lexer* lexer, char* message)
 {
-    // get the current token
-    Token token = lexer->current_node->token;
-
-    // advance to the end of the statement
-    while (token.type != T_STATEMENT_END && token.type != T_EOF) {
-        token = lexer_next(lexer);
+    // errors while recovering from an earlier one are just fallout from it
+    if (parser_panicking) {
+        return E_PARSE_ERROR;
     }
+    parser_panicking = true;
+    parser_error_count++;
+
+    // get the current token
+    Token token = lexer_current(lexer);
 
     // display the error message
     return error(
         E_PARSE_ERROR,
         "in file \"%s\" near line %d, column %d:\n\t%s",
-        token.file,
-        token.line,
-        token.column,
+        token_file(token),
+        token_line(token),
+        token_column(token),
         message
     );
 }
 
 /**
- * Tries to parse a numerical string and returns its value.
+ * Skips tokens after a syntax error until the parser is back in sync with the
+ * given set of tokens; see parser_sync_statement() and parser_sync_member().
  */
-long parser_str_to_long(char* string)
+static void parser_sync(Lexer* lexer, long int start, const bool* sync_tokens)
 {
-    return strtol(string, NULL, 0);
+    int depth = 0;
+    Token token = lexer_current(lexer);
+
+    // the token that gave the error away might be where to pick up again; if
+    // it was the ; the broken part is over already
+    if (lexer->current > start && token.type == T_STATEMENT_END) {
+        parser_panicking = false;
+        return;
+    } else if (lexer->current > start + 1 && sync_tokens[token.type]) {
+        // a bounded lexer may have dropped the token before it from its
+        // window; then the sync token stays read, so skip on to the next one,
+        // and past the whole block if it opened one
+        if (lexer_backtrack(lexer) != E_SUCCESS && token.type == T_BRACE_LEFT) {
+            depth++;
+        }
+    } else if (lexer->current > start && token.type == T_BRACE_LEFT && !sync_tokens[T_BRACE_LEFT]) {
+        depth++;
+    }
+
+    // always get past at least one token so a list can't get stuck
+    token = lexer_lookahead(lexer, 1);
+    if (lexer->current == start && token.type != T_BRACE_RIGHT && token.type != T_EOF) {
+        lexer_next(lexer);
+        if (token.type == T_STATEMENT_END) {
+            parser_panicking = false;
+            return;
+        }
+        depth += token.type == T_BRACE_LEFT && !sync_tokens[T_BRACE_LEFT];
+        token = lexer_lookahead(lexer, 1);
+    }
+
+    // skip to the next sync token, skipping whole blocks if they aren't sync
+    // tokens themselves
+    while (token.type != T_EOF && (depth > 0 || !sync_tokens[token.type])) {
+        if (token.type == T_BRACE_LEFT) {
+            depth++;
+        } else if (token.type == T_BRACE_RIGHT) {
+            depth--;
+        }
+
+        lexer_next(lexer);
+        token = lexer_lookahead(lexer, 1);
+    }
+
+    // a ; ends the broken part, so it goes too
+    if (token.type == T_STATEMENT_END) {
+        lexer_next(lexer);
+    }
+
+    parser_panicking = false;
 }
 
 /**
- * Creates a copy of a string with single and double quotes stripped from the
- * ends of the string.
+ * Skips tokens after a syntax error in a statement until the parser is back in
+ * sync: past the next ;, or up to the next token that starts a statement or
+ * ends the block.
  */
-char* parser_strip_quotes(const char* string)
+void parser_sync_statement(Lexer* lexer, long int start)
 {
-    size_t new_length = strlen(string) - 2;
-    char* new_string = malloc(sizeof(char) * (new_length + 1));
-    strncpy(new_string, string + 1, new_length);
-    new_string[new_length] = 0;
-    return new_string;
+    parser_sync(lexer, start, parser_statement_sync);
 }
 
+/**
+ * Skips tokens after a syntax error in a class member until the parser is back
+ * in sync: past the next ; outside of any block, or up to the next token
+ * outside of any block that starts a member or ends the class.
+ */
+void parser_sync_member(Lexer* lexer, long int start)
+{
+    parser_sync(lexer, start, parser_member_sync);
+}
+
+/**
+ * Precedence of each binary operator token, from loosest to tightest binding.
+ * Tokens that aren't binary operators have a precedence of 0.
+ */
+static const unsigned char parser_bin_op_precedence[T_WHITESPACE + 1] = {
+    [T_LOGICAL_OR] = 1,
+    [T_LOGICAL_AND] = 2,
+    [T_IS_EQUAL] = 3,
+    [T_IS_NOT_EQUAL] = 3,
+    [T_IS_GREATER] = 4,
+    [T_IS_GREATER_OR_EQUAL] = 4,
+    [T_IS_LESSER] = 4,
+    [T_IS_LESSER_OR_EQUAL] = 4,
+    [T_MINUS] = 5,
+    [T_PLUS] = 5,
+    [T_DIVIDE] = 6,
+    [T_MODULO] = 6,
+    [T_MULTIPLY] = 6
+};
+
+/**
+ * The operator each binary or assignment operator token stands for.
+ */
+static const ASTOperator parser_operators[T_WHITESPACE + 1] = {
+    [T_LOGICAL_OR] = OP_OR,
+    [T_LOGICAL_AND] = OP_AND,
+    [T_IS_EQUAL] = OP_EQUAL,
+    [T_IS_NOT_EQUAL] = OP_NOT_EQUAL,
+    [T_IS_GREATER] = OP_GREATER,
+    [T_IS_GREATER_OR_EQUAL] = OP_GREATER_OR_EQUAL,
+    [T_IS_LESSER] = OP_LESSER,
+    [T_IS_LESSER_OR_EQUAL] = OP_LESSER_OR_EQUAL,
+    [T_MINUS] = OP_SUBTRACT,
+    [T_PLUS] = OP_ADD,
+    [T_DIVIDE] = OP_DIVIDE,
+    [T_MODULO] = OP_MODULO,
+    [T_MULTIPLY] = OP_MULTIPLY,
+    [T_EQUAL] = OP_ASSIGN,
+    [T_PLUS_EQUAL] = OP_ADD_ASSIGN,
+    [T_MINUS_EQUAL] = OP_SUBTRACT_ASSIGN
+};
+
 /**
  * Checks if a token is a binary operator.
  */
 static inline bool token_is_bin_op(Token token)
 {
-    return token.type == T_DIVIDE
-        || token.type == T_IS_EQUAL
-        || token.type == T_IS_GREATER
-        || token.type == T_IS_GREATER_OR_EQUAL
-        || token.type == T_IS_LESSER
-        || token.type == T_IS_LESSER_OR_EQUAL
-        || token.type == T_IS_NOT_EQUAL
-        || token.type == T_LOGICAL_AND
-        || token.type == T_LOGICAL_OR
-        || token.type == T_MINUS
-        || token.type == T_MODULO
-        || token.type == T_MULTIPLY
-        || token.type == T_PLUS;
+    return parser_bin_op_precedence[token.type] > 0;
 }
 
 /**
@@ -93,8 +235,8 @@ static inline bool token_is_bin_op(Token token)
  */
 Error parser_parse_program(Lexer* lexer, ASTDecl** node)
 {
-    *node = ast_create_node(AST_CLASS_DECL, lexer->context->file);
-    (*node)->identifier = "Program";
+    *node = ast_create_node(parser_arena, AST_CLASS_DECL, lexer->context->file);
+    (*node)->identifier = intern_string("Program", 7);
 
     Token token = lexer_next(lexer);
     if (token.type != T_CLASS) {
@@ -102,11 +244,11 @@ Error parser_parse_program(Lexer* lexer, ASTDecl** node)
     }
 
     // set line and column
-    ((ASTNode*)*node)->line = token.line;
-    ((ASTNode*)*node)->column = token.column;
+    ((ASTNode*)*node)->line = token_line(token);
+    ((ASTNode*)*node)->column = token_column(token);
 
     token = lexer_next(lexer);
-    if (token.type != T_IDENTIFIER || strcmp(token.lexeme, "Program") != 0) {
+    if (token.type != T_IDENTIFIER || !lexer_token_matches(lexer, token, "Program")) {
         return parser_error(lexer, "Expecting 'Program'.");
     }
 
@@ -136,22 +278,23 @@ Error parser_parse_program(Lexer* lexer, ASTDecl** node)
  */
 Error parser_parse_field_decl_list(Lexer* lexer, ASTDecl* program)
 {
-    // do a lookahead
-    Token token = lexer_lookahead(lexer, 1);
+    // keep parsing fields while the next tokens look like a field decl rather
+    // than a method decl
+    while (true) {
+        Token token = lexer_lookahead(lexer, 1);
+        if (token.type != T_BOOLEAN && token.type != T_INT) {
+            break;
+        }
 
-    // try to parse a field decl?
-    if (token.type == T_BOOLEAN || token.type == T_INT) {
         // might be a field decl, do a further lookahead
-        token = lexer_lookahead(lexer, 3);
-
-        // start parsing fields
-        if (token.type != T_PAREN_LEFT) {
-            if (parser_parse_field_decl(lexer, program) != E_SUCCESS) {
-                return E_PARSE_ERROR;
-            }
+        if (lexer_lookahead(lexer, 3).type == T_PAREN_LEFT) {
+            break;
+        }
 
-            // if that worked, we must have a field_decl_list next
-            return parser_parse_field_decl_list(lexer, program);
+        // skip a broken field decl and carry on with the next member
+        long int start = lexer->current;
+        if (parser_parse_field_decl(lexer, program) != E_SUCCESS) {
+            parser_sync_member(lexer, start);
         }
     }
 
@@ -164,23 +307,21 @@ Error parser_parse_field_decl_list(Lexer* lexer, ASTDecl* program)
  */
 Error parser_parse_method_decl_list(Lexer* lexer, ASTDecl* program)
 {
-    Token first_token = lexer_lookahead(lexer, 1);
-
-    // epsilon
-    if (first_token.type == T_BRACE_RIGHT) {
-        return E_SUCCESS;
-    }
-
-    // try to parse a method decl
-    ASTDecl* method_decl;
-    if (parser_parse_method_decl(lexer, &method_decl) != E_SUCCESS) {
-        return E_PARSE_ERROR;
-    } else {
-        ast_add_child(program, method_decl);
+    // parse method decls until the end of the class
+    Token token;
+    while ((token = lexer_lookahead(lexer, 1)).type != T_BRACE_RIGHT && token.type != T_EOF) {
+        // skip a broken method decl and carry on with the next member
+        long int start = lexer->current;
+        ASTDecl* method_decl;
+        if (parser_parse_method_decl(lexer, &method_decl) != E_SUCCESS) {
+            parser_sync_member(lexer, start);
+            continue;
+        }
+        ast_add_child(parser_arena, program, method_decl);
     }
 
-   // if that worked, we must have a method_decl_list
-    return parser_parse_method_decl_list(lexer, program);
+    // epsilon
+    return E_SUCCESS;
 }
 
 /**
@@ -203,13 +344,25 @@ Error parser_parse_field_decl(Lexer* lexer, ASTDecl* program)
  */
 Error parser_parse_field_id_list(Lexer* lexer, DataType type, ASTDecl* program)
 {
-    ASTDecl* node = ast_create_node(AST_FIELD_DECL, lexer->context->file);
+    if (parser_parse_field_id(lexer, type, program) != E_SUCCESS) {
+        return E_PARSE_ERROR;
+    }
+
+    return parser_parse_field_id_list_tail(lexer, type, program);
+}
+
+/**
+ * Parses a single field in a field list: <id> <array_dim_decl>
+ */
+Error parser_parse_field_id(Lexer* lexer, DataType type, ASTDecl* program)
+{
+    ASTDecl* node = ast_create_node(parser_arena, AST_FIELD_DECL, lexer->context->file);
     ((ASTNode*)node)->type = type;
 
     // set line and column
     Token next_token = lexer_lookahead(lexer, 1);
-    ((ASTNode*)node)->line = next_token.line;
-    ((ASTNode*)node)->column = next_token.column;
+    ((ASTNode*)node)->line = token_line(next_token);
+    ((ASTNode*)node)->column = token_column(next_token);
 
     if (parser_parse_id(lexer, &node->identifier) != E_SUCCESS) {
         return parser_error(lexer, "Expected field name.");
@@ -224,11 +377,7 @@ Error parser_parse_field_id_list(Lexer* lexer, DataType type, ASTDecl* program)
         return E_PARSE_ERROR;
     }
 
-    if (parser_parse_field_id_list_tail(lexer, type, program) != E_SUCCESS) {
-        return E_PARSE_ERROR;
-    }
-
-    ast_add_child(program, node);
+    ast_add_child(parser_arena, program, node);
     return E_SUCCESS;
 }
 
@@ -246,8 +395,9 @@ Error parser_parse_array_dim_decl(Lexer* lexer, int* length)
         if (parser_parse_int_literal(lexer, &int_literal) != E_SUCCESS) {
             return parser_error(lexer, "Expected array length.");
         }
-        // fetch the int value as the length
-        *length = *(int*)(int_literal->value);
+        // fetch the int value as the length; lengths out of range are invalid
+        long value = int_literal->value.int_value;
+        *length = value > INT_MAX ? 0 : value;
 
         token = lexer_next(lexer);
         if (token.type != T_BRACKET_RIGHT) {
@@ -264,13 +414,15 @@ Error parser_parse_array_dim_decl(Lexer* lexer, int* length)
  */
 Error parser_parse_field_id_list_tail(Lexer* lexer, DataType type, ASTDecl* program)
 {
-    Token token = lexer_next(lexer);
-    if (token.type == T_COMMA) {
-        //first derivation
-        if (parser_parse_field_id_list(lexer, type, program) != E_SUCCESS) {
+    // first derivation, once for each remaining field
+    Token token;
+    while ((token = lexer_next(lexer)).type == T_COMMA) {
+        if (parser_parse_field_id(lexer, type, program) != E_SUCCESS) {
             return parser_error(lexer, "Expected field id list.");
         }
-    } else if (token.type != T_STATEMENT_END) {
+    }
+
+    if (token.type != T_STATEMENT_END) {
         return parser_error(lexer, "Missing semicolon ';' or comma ',' after field declaration.");
     }
 
@@ -283,14 +435,14 @@ Error parser_parse_field_id_list_tail(Lexer* lexer, DataType type, ASTDecl* prog
  */
 Error parser_parse_method_decl(Lexer* lexer, ASTDecl** node)
 {
-    *node = ast_create_node(AST_METHOD_DECL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_METHOD_DECL, lexer->context->file);
     ((ASTNode*)*node)->type = TYPE_VOID;
     (*node)->flags = SYMBOL_FUNCTION;
 
     // set line and column
     Token next_token = lexer_lookahead(lexer, 1);
-    ((ASTNode*)*node)->line = next_token.line;
-    ((ASTNode*)*node)->column = next_token.column;
+    ((ASTNode*)*node)->line = token_line(next_token);
+    ((ASTNode*)*node)->column = token_column(next_token);
 
     // can start with <type> or void
     if (next_token.type == T_VOID) {
@@ -324,7 +476,7 @@ Error parser_parse_method_decl(Lexer* lexer, ASTDecl** node)
     if (parser_parse_block(lexer, &block) != E_SUCCESS) {
         return E_PARSE_ERROR;
     } else {
-        ast_add_child(*node, block);
+        ast_add_child(parser_arena, *node, block);
     }
 
     // we made it!
@@ -345,7 +497,7 @@ Error parser_parse_method_param_decl_list(Lexer* lexer, ASTDecl* method)
     if (parser_parse_method_param_decl(lexer, &param) != E_SUCCESS) {
         return parser_error(lexer, "Expected parameter declaration.");
     } else {
-        ast_add_child(method, param);
+        ast_add_child(parser_arena, method, param);
     }
 
     if (parser_parse_method_param_decl_list_tail(lexer, method) != E_SUCCESS) {
@@ -360,20 +512,15 @@ Error parser_parse_method_param_decl_list(Lexer* lexer, ASTDecl* method)
  */
 Error parser_parse_method_param_decl_list_tail(Lexer* lexer, ASTDecl* method)
 {
-    // first derivation
-    if (lexer_lookahead(lexer, 1).type == T_COMMA) {
+    // first derivation, once for each remaining parameter
+    while (lexer_lookahead(lexer, 1).type == T_COMMA) {
         lexer_next(lexer);
 
         ASTDecl* param;
         if (parser_parse_method_param_decl(lexer, &param) != E_SUCCESS) {
             return parser_error(lexer, "Expected method parameter declaration.");
-        } else {
-            ast_add_child(method, param);
-        }
-
-        if (parser_parse_method_param_decl_list_tail(lexer, method) != E_SUCCESS) {
-            return parser_error(lexer, "Expected parameter list tail.");
         }
+        ast_add_child(parser_arena, method, param);
     }
 
     // epsilon
@@ -385,12 +532,12 @@ Error parser_parse_method_param_decl_list_tail(Lexer* lexer, ASTDecl* method)
  */
 Error parser_parse_method_param_decl(Lexer* lexer, ASTDecl** node)
 {
-    *node = ast_create_node(AST_PARAM_DECL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_PARAM_DECL, lexer->context->file);
 
     // set line and column
     Token next_token = lexer_lookahead(lexer, 1);
-    ((ASTNode*)*node)->line = next_token.line;
-    ((ASTNode*)*node)->column = next_token.column;
+    ((ASTNode*)*node)->line = token_line(next_token);
+    ((ASTNode*)*node)->column = token_column(next_token);
 
     if (parser_parse_type(lexer, &((ASTNode*)*node)->type) != E_SUCCESS) {
         return parser_error(lexer, "Expected parameter type.");
@@ -408,7 +555,7 @@ Error parser_parse_method_param_decl(Lexer* lexer, ASTDecl** node)
  */
 Error parser_parse_block(Lexer* lexer, ASTNode** node)
 {
-    *node = ast_create_node(AST_BLOCK, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_BLOCK, lexer->context->file);
 
     Token token = lexer_next(lexer);
     if (token.type != T_BRACE_LEFT) {
@@ -416,8 +563,8 @@ Error parser_parse_block(Lexer* lexer, ASTNode** node)
     }
 
     // set line and column
-    (*node)->line = token.line;
-    (*node)->column = token.column;
+    (*node)->line = token_line(token);
+    (*node)->column = token_column(token);
 
     if (parser_parse_var_decl_list(lexer, *node) != E_SUCCESS) {
         return E_PARSE_ERROR;
@@ -439,16 +586,13 @@ Error parser_parse_block(Lexer* lexer, ASTNode** node)
  */
 Error parser_parse_var_decl_list(Lexer* lexer, ASTNode* parent)
 {
-    Token token = lexer_lookahead(lexer, 1);
-
-    // first derivation
-    if (token.type == T_BOOLEAN || token.type == T_INT) {
+    // first derivation, once for each var decl
+    Token token;
+    while ((token = lexer_lookahead(lexer, 1)).type == T_BOOLEAN || token.type == T_INT) {
+        // skip a broken var decl and carry on with the next one
+        long int start = lexer->current;
         if (parser_parse_var_decl(lexer, parent) != E_SUCCESS) {
-            return E_PARSE_ERROR;
-        }
-
-        if (parser_parse_var_decl_list(lexer, parent) != E_SUCCESS) {
-            return E_PARSE_ERROR;
+            parser_sync_statement(lexer, start);
         }
     }
 
@@ -461,22 +605,20 @@ Error parser_parse_var_decl_list(Lexer* lexer, ASTNode* parent)
  */
 Error parser_parse_statement_list(Lexer* lexer, ASTNode* parent)
 {
-    // epsilon
-    if (lexer_lookahead(lexer, 1).type == T_BRACE_RIGHT) {
-        return E_SUCCESS;
-    }
-
-    // first derivation
-    ASTNode* statement;
-    if (parser_parse_statement(lexer, &statement) != E_SUCCESS) {
-        return E_PARSE_ERROR;
-    }
-    ast_add_child(parent, statement);
-
-    if (parser_parse_statement_list(lexer, parent) != E_SUCCESS) {
-        return E_PARSE_ERROR;
+    // first derivation, until the end of the block
+    Token token;
+    while ((token = lexer_lookahead(lexer, 1)).type != T_BRACE_RIGHT && token.type != T_EOF) {
+        // skip a broken statement and carry on with the next one
+        long int start = lexer->current;
+        ASTNode* statement;
+        if (parser_parse_statement(lexer, &statement) != E_SUCCESS) {
+            parser_sync_statement(lexer, start);
+            continue;
+        }
+        ast_add_child(parser_arena, parent, statement);
     }
 
+    // epsilon
     return E_SUCCESS;
 }
 
@@ -485,12 +627,12 @@ Error parser_parse_statement_list(Lexer* lexer, ASTNode* parent)
  */
 Error parser_parse_var_decl(Lexer* lexer, ASTNode* parent)
 {
-    ASTDecl* node = ast_create_node(AST_VAR_DECL, lexer->context->file);
+    ASTDecl* node = ast_create_node(parser_arena, AST_VAR_DECL, lexer->context->file);
 
     // set line and column
     Token next_token = lexer_lookahead(lexer, 1);
-    ((ASTNode*)node)->line = next_token.line;
-    ((ASTNode*)node)->column = next_token.column;
+    ((ASTNode*)node)->line = token_line(next_token);
+    ((ASTNode*)node)->column = token_column(next_token);
 
     if (parser_parse_type(lexer, &((ASTNode*)node)->type) != E_SUCCESS) {
         return parser_error(lexer, "Expected variable type.");
@@ -500,7 +642,7 @@ Error parser_parse_var_decl(Lexer* lexer, ASTNode* parent)
         return parser_error(lexer, "Expected variable name.");
     }
 
-    ast_add_child(parent, node);
+    ast_add_child(parser_arena, parent, node);
     return parser_parse_var_id_list_tail(lexer, ((ASTNode*)node)->type, parent);
 }
 
@@ -509,26 +651,25 @@ Error parser_parse_var_decl(Lexer* lexer, ASTNode* parent)
  */
 Error parser_parse_var_id_list_tail(Lexer* lexer, DataType type, ASTNode* parent)
 {
-    Token token = lexer_next(lexer);
-    if (token.type == T_COMMA) {
-        ASTDecl* node = ast_create_node(AST_VAR_DECL, lexer->context->file);
+    // first derivation, once for each remaining variable
+    Token token;
+    while ((token = lexer_next(lexer)).type == T_COMMA) {
+        ASTDecl* node = ast_create_node(parser_arena, AST_VAR_DECL, lexer->context->file);
         ((ASTNode*)node)->type = type;
 
         // set line and column
-        ((ASTNode*)node)->line = token.line;
-        ((ASTNode*)node)->column = token.column;
+        ((ASTNode*)node)->line = token_line(token);
+        ((ASTNode*)node)->column = token_column(token);
 
         //first derivation
         if (parser_parse_id(lexer, &node->identifier) != E_SUCCESS) {
             return parser_error(lexer, "Expected identifier.");
         }
 
-        ast_add_child(parent, node);
+        ast_add_child(parser_arena, parent, node);
+    }
 
-        if (parser_parse_var_id_list_tail(lexer, type, parent) != E_SUCCESS) {
-            return parser_error(lexer, "Expected variable identifier list tail.");
-        }
-    } else if (token.type != T_STATEMENT_END) {
+    if (token.type != T_STATEMENT_END) {
         return parser_error(lexer, "Missing semicolon ';' or comma ',' after variable declaration.");
     }
 
@@ -594,14 +735,14 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
         if (parser_parse_assign_op(lexer, (ASTOperation**)node) != E_SUCCESS) {
             return parser_error(lexer, "Expected assignment operator.");
         }
-        ast_add_child(*node, location);
+        ast_add_child(parser_arena, *node, location);
 
         // now parse the right operand expression
         ASTNode* expr;
         if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(*node, expr);
+        ast_add_child(parser_arena, *node, expr);
 
         // semicolon
         if (lexer_next(lexer).type != T_STATEMENT_END) {
@@ -624,11 +765,11 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
     lexer_next(lexer);
     // third derivation - if statement
     if (token.type == T_IF) {
-        *node = ast_create_node(AST_IF_STATEMENT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_IF_STATEMENT, lexer->context->file);
 
         // set line and column
-        ((ASTNode*)*node)->line = token.line;
-        ((ASTNode*)*node)->column = token.column;
+        ((ASTNode*)*node)->line = token_line(token);
+        ((ASTNode*)*node)->column = token_column(token);
 
         if (lexer_next(lexer).type != T_PAREN_LEFT) {
             return parser_error(lexer, "Missing opening parenthesis.");
@@ -638,7 +779,7 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
         if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(*node, expr);
+        ast_add_child(parser_arena, *node, expr);
 
         if (lexer_next(lexer).type != T_PAREN_RIGHT) {
             return parser_error(lexer, "Missing closing parenthesis.");
@@ -648,7 +789,7 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
         if (parser_parse_block(lexer, &block) != E_SUCCESS) {
             return parser_error(lexer, "Expected block.");
         }
-        ast_add_child(*node, block);
+        ast_add_child(parser_arena, *node, block);
 
         if (parser_parse_else_expr(lexer, *node) != E_SUCCESS) {
             return parser_error(lexer, "Expected else expression.");
@@ -659,59 +800,59 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
 
     // fourth derivation
     else if (token.type == T_FOR) {
-        *node = ast_create_node(AST_FOR_STATEMENT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_FOR_STATEMENT, lexer->context->file);
 
         // set line and column
-        (*node)->line = token.line;
-        (*node)->column = token.column;
+        (*node)->line = token_line(token);
+        (*node)->column = token_column(token);
 
         // variable used in the loop
-        ASTDecl* var = ast_create_node(AST_VAR_DECL, lexer->context->file);
+        ASTDecl* var = ast_create_node(parser_arena, AST_VAR_DECL, lexer->context->file);
         // is always an int
         ((ASTNode*)var)->type = TYPE_INT;
 
         // set line and column
         Token next_token = lexer_lookahead(lexer, 1);
-        ((ASTNode*)var)->line = next_token.line;
-        ((ASTNode*)var)->column = next_token.column;
+        ((ASTNode*)var)->line = token_line(next_token);
+        ((ASTNode*)var)->column = token_column(next_token);
 
         // get the variable id
         if (parser_parse_id(lexer, &var->identifier) != E_SUCCESS) {
             return parser_error(lexer, "Expected variable name.");
         }
-        ast_add_child(*node, var);
+        ast_add_child(parser_arena, *node, var);
 
         // the variable is declared and assigned to in one go; create the
         // assignment node now
-        ASTOperation* assignment = ast_create_node(AST_ASSIGN_OP, lexer->context->file);
+        ASTOperation* assignment = ast_create_node(parser_arena, AST_ASSIGN_OP, lexer->context->file);
         // get the operator
         Token operator_token = lexer_next(lexer);
         if (operator_token.type != T_EQUAL) {
             return parser_error(lexer, "Expected equals '=' sign.");
         }
-        assignment->operator = operator_token.lexeme;
-        ast_add_child(*node, assignment);
+        assignment->operator = OP_ASSIGN;
+        ast_add_child(parser_arena, *node, assignment);
 
         // set line and column
-        ((ASTNode*)assignment)->line = operator_token.line;
-        ((ASTNode*)assignment)->column = operator_token.column;
+        ((ASTNode*)assignment)->line = token_line(operator_token);
+        ((ASTNode*)assignment)->column = token_column(operator_token);
 
         // now make the "location" node - the location assigned to
-        ASTReference* location = ast_create_node(AST_LOCATION, lexer->context->file);
+        ASTReference* location = ast_create_node(parser_arena, AST_LOCATION, lexer->context->file);
         // variable name is same as in declaration
         location->identifier = var->identifier;
-        ast_add_child(assignment, location);
+        ast_add_child(parser_arena, assignment, location);
 
         // set line and column
-        ((ASTNode*)location)->line = next_token.line;
-        ((ASTNode*)location)->column = next_token.column;
+        ((ASTNode*)location)->line = token_line(next_token);
+        ((ASTNode*)location)->column = token_column(next_token);
 
         // get the assignment value expression
         ASTNode* expr;
         if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(assignment, expr);
+        ast_add_child(parser_arena, assignment, expr);
 
         if (lexer_next(lexer).type != T_COMMA) {
             return parser_error(lexer, "Expected comma ',' after expression.");
@@ -720,24 +861,24 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
         if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(*node, expr);
+        ast_add_child(parser_arena, *node, expr);
 
         ASTNode* block;
         if (parser_parse_block(lexer, &block) != E_SUCCESS) {
             return parser_error(lexer, "Expected block.");
         }
-        ast_add_child(*node, block);
+        ast_add_child(parser_arena, *node, block);
 
         return E_SUCCESS;
     }
 
     // fifth derivation - return statement
     else if (token.type == T_RETURN) {
-        *node = ast_create_node(AST_RETURN_STATEMENT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_RETURN_STATEMENT, lexer->context->file);
 
         // set line and column
-        (*node)->line = token.line;
-        (*node)->column = token.column;
+        (*node)->line = token_line(token);
+        (*node)->column = token_column(token);
 
         if (parser_parse_expr_option(lexer, *node) != E_SUCCESS) {
             return E_PARSE_ERROR;
@@ -752,11 +893,11 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
 
     // sixth derivation
     else if (token.type == T_BREAK) {
-        *node = ast_create_node(AST_BREAK_STATEMENT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_BREAK_STATEMENT, lexer->context->file);
 
         // set line and column
-        (*node)->line = token.line;
-        (*node)->column = token.column;
+        (*node)->line = token_line(token);
+        (*node)->column = token_column(token);
 
         if (lexer_next(lexer).type != T_STATEMENT_END) {
             return parser_error(lexer, "Missing semicolon at end of statement.");
@@ -767,11 +908,11 @@ Error parser_parse_statement(Lexer* lexer, ASTNode** node)
 
     // seventh derivation
     else if (token.type == T_CONTINUE) {
-        *node = ast_create_node(AST_CONTINUE_STATEMENT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_CONTINUE_STATEMENT, lexer->context->file);
 
         // set line and column
-        (*node)->line = token.line;
-        (*node)->column = token.column;
+        (*node)->line = token_line(token);
+        (*node)->column = token_column(token);
 
         if (lexer_next(lexer).type != T_STATEMENT_END) {
             return parser_error(lexer, "Missing semicolon at end of statement.");
@@ -795,19 +936,19 @@ Error parser_parse_else_expr(Lexer* lexer, ASTNode* parent)
         lexer_next(lexer);
 
         // create an else node
-        ASTNode* else_expr = ast_create_node(AST_ELSE_STATEMENT, lexer->context->file);
-        ast_add_child(parent, else_expr);
+        ASTNode* else_expr = ast_create_node(parser_arena, AST_ELSE_STATEMENT, lexer->context->file);
+        ast_add_child(parser_arena, parent, else_expr);
 
         // set line and column
-        else_expr->line = token.line;
-        else_expr->column = token.column;
+        else_expr->line = token_line(token);
+        else_expr->column = token_column(token);
 
         // parse the else's block
         ASTNode* block;
         if (parser_parse_block(lexer, &block) != E_SUCCESS) {
             return parser_error(lexer, "Expected block following else statement.");
         }
-        ast_add_child(else_expr, block);
+        ast_add_child(parser_arena, else_expr, block);
     }
 
     // epsilon
@@ -829,7 +970,7 @@ Error parser_parse_expr_option(Lexer* lexer, ASTNode* parent)
     if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
         return E_PARSE_ERROR;
     }
-    ast_add_child(parent, expr);
+    ast_add_child(parser_arena, parent, expr);
 
     return E_SUCCESS;
 }
@@ -845,12 +986,12 @@ Error parser_parse_assign_op(Lexer* lexer, ASTOperation** node)
         return parser_error(lexer, "Expected an assignment operator ('=', '+=', '-=').");
     }
 
-    *node = ast_create_node(AST_ASSIGN_OP, lexer->context->file);
-    (*node)->operator = token.lexeme;
+    *node = ast_create_node(parser_arena, AST_ASSIGN_OP, lexer->context->file);
+    (*node)->operator = parser_operators[token.type];
 
     // set line and column
-    ((ASTNode*)*node)->line = token.line;
-    ((ASTNode*)*node)->column = token.column;
+    ((ASTNode*)*node)->line = token_line(token);
+    ((ASTNode*)*node)->column = token_column(token);
 
     return E_SUCCESS;
 }
@@ -866,21 +1007,21 @@ Error parser_parse_method_call(Lexer* lexer, ASTReference** node)
     // library callout call
     if (first_token.type == T_CALLOUT) {
         lexer_next(lexer);
-        *node = ast_create_node(AST_CALLOUT, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_CALLOUT, lexer->context->file);
 
         // set line and column
-        ((ASTNode*)*node)->line = first_token.line;
-        ((ASTNode*)*node)->column = first_token.column;
+        ((ASTNode*)*node)->line = token_line(first_token);
+        ((ASTNode*)*node)->column = token_column(first_token);
 
         // we know the return type already; is always int
         ((ASTNode*)*node)->type = TYPE_INT;
     } else {
         // standard method call
-        *node = ast_create_node(AST_METHOD_CALL, lexer->context->file);
+        *node = ast_create_node(parser_arena, AST_METHOD_CALL, lexer->context->file);
 
         // set line and column
-        ((ASTNode*)*node)->line = first_token.line;
-        ((ASTNode*)*node)->column = first_token.column;
+        ((ASTNode*)*node)->line = token_line(first_token);
+        ((ASTNode*)*node)->column = token_column(first_token);
 
         // parse the method name
         if (parser_parse_method_name(lexer, &(*node)->identifier) != E_SUCCESS) {
@@ -900,7 +1041,7 @@ Error parser_parse_method_call(Lexer* lexer, ASTReference** node)
         if (parser_parse_string_literal(lexer, &string_literal) != E_SUCCESS) {
             return parser_error(lexer, "Expected library function name in callout.");
         }
-        (*node)->identifier = (char*)string_literal->value;
+        (*node)->identifier = string_literal->value.string_value;
 
         // parse the arguments, if any
         if (parser_parse_callout_arg_list(lexer, *node) != E_SUCCESS) {
@@ -934,7 +1075,7 @@ Error parser_parse_expr_list(Lexer* lexer, ASTNode* parent)
     if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
         return E_PARSE_ERROR;
     }
-    ast_add_child(parent, expr);
+    ast_add_child(parser_arena, parent, expr);
 
     // see if there are more expressions to parse
     return parser_parse_expr_list_tail(lexer, parent);
@@ -945,27 +1086,20 @@ Error parser_parse_expr_list(Lexer* lexer, ASTNode* parent)
  */
 Error parser_parse_expr_list_tail(Lexer* lexer, ASTNode* parent)
 {
-    Token first_token = lexer_lookahead(lexer, 1);
-
-    // no more commas - end of expr list
-    if (first_token.type != T_COMMA) {
-        // epsilon derivation
-        return E_SUCCESS;
-    }
-
-    // consume the comma
-    lexer_next(lexer);
-
-    // parse another expr and add it to the parent
+    // parse another expr after each comma and add it to the parent
+    while (lexer_lookahead(lexer, 1).type == T_COMMA) {
+        // consume the comma
+        lexer_next(lexer);
 
-    ASTNode* expr;
-    if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
-        return parser_error(lexer, "Expected another expression following comma.");
+        ASTNode* expr;
+        if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
+            return parser_error(lexer, "Expected another expression following comma.");
+        }
+        ast_add_child(parser_arena, parent, expr);
     }
-    ast_add_child(parent, expr);
 
-    // see if there are more expressions to parse
-    return parser_parse_expr_list_tail(lexer, parent);
+    // no more commas - end of expr list; epsilon derivation
+    return E_SUCCESS;
 }
 
 /**
@@ -973,20 +1107,15 @@ Error parser_parse_expr_list_tail(Lexer* lexer, ASTNode* parent)
  */
 Error parser_parse_callout_arg_list(Lexer* lexer, ASTReference* parent)
 {
-    Token token = lexer_lookahead(lexer, 1);
-
-    // first derivation
-    if (token.type == T_COMMA) {
+    // first derivation, once for each argument
+    while (lexer_lookahead(lexer, 1).type == T_COMMA) {
         lexer_next(lexer);
 
         ASTNode* arg;
         if (parser_parse_callout_arg(lexer, &arg) != E_SUCCESS) {
             return parser_error(lexer, "Expected another argument in callout argument list.");
         }
-        ast_add_child(parent, arg);
-
-        // parse more arguments if there are any
-        return parser_parse_callout_arg_list(lexer, parent);
+        ast_add_child(parser_arena, parent, arg);
     }
 
     // epsilon
@@ -996,7 +1125,7 @@ Error parser_parse_callout_arg_list(Lexer* lexer, ASTReference* parent)
 /**
  * <method_name> -> <id>
  */
-Error parser_parse_method_name(Lexer* lexer, char** identifier)
+Error parser_parse_method_name(Lexer* lexer, const char** identifier)
 {
     return parser_parse_id(lexer, identifier);
 }
@@ -1006,12 +1135,12 @@ Error parser_parse_method_name(Lexer* lexer, char** identifier)
  */
 Error parser_parse_location(Lexer* lexer, ASTReference** node)
 {
-    *node = ast_create_node(AST_LOCATION, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_LOCATION, lexer->context->file);
     Token token = lexer_lookahead(lexer, 1);
 
     // set line and column
-    ((ASTNode*)*node)->line = token.line;
-    ((ASTNode*)*node)->column = token.column;
+    ((ASTNode*)*node)->line = token_line(token);
+    ((ASTNode*)*node)->column = token_column(token);
 
     if (parser_parse_id(lexer, &(*node)->identifier) != E_SUCCESS) {
         return parser_error(lexer, "Failure in parsing location - parser_parse_id failed.");
@@ -1035,7 +1164,7 @@ Error parser_parse_array_subscript_expr(Lexer* lexer, ASTReference* parent)
         if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression inside array subscript.");
         }
-        ast_add_child(parent, expr);
+        ast_add_child(parser_arena, parent, expr);
 
         if (lexer_next(lexer).type != T_BRACKET_RIGHT) {
             return parser_error(lexer, "Missing closing bracket in array subscript expression.");
@@ -1047,50 +1176,44 @@ Error parser_parse_array_subscript_expr(Lexer* lexer, ASTReference* parent)
 }
 
 /**
- * Note that this function parses the following 2 grammar rules at once:
- *
- *     <expr> -> <expr_part> <expr_end>
- *     <expr_end> -> <bin_op> <expr> | EPSILON
+ * Parses a generic expression, starting at the loosest binding operators.
  */
 Error parser_parse_expr(Lexer* lexer, ASTNode** node)
 {
-    // Create a node for the expression parsed. We don't know yet if this
-    // expression is an operand for a binary operation or not.
-    ASTNode* left_expr;
+    return parser_parse_bin_op_expr(lexer, node, 1);
+}
 
+/**
+ * Parses an expression made of operators that bind at least as tightly as the
+ * given precedence, by precedence climbing.
+ */
+Error parser_parse_bin_op_expr(Lexer* lexer, ASTNode** node, int min_precedence)
+{
     // parse the primary expression
-    if (parser_parse_expr_part(lexer, &left_expr) != E_SUCCESS) {
+    if (parser_parse_expr_part(lexer, node) != E_SUCCESS) {
         return E_PARSE_ERROR;
     }
 
-    // Now check if there is a binary operator following the above expression.
-    // If there is, try and parse it and make it the parent node for the left
-    // and right operand expressions.
-    if (token_is_bin_op(lexer_lookahead(lexer, 1))) {
-        // We do have a binary operation, so set the following operation node
-        // as the root node of the expression.
-        if (parser_parse_bin_op(lexer, (ASTOperation**)node) != E_SUCCESS) {
+    // fold each operator that binds at least as tightly as the minimum into
+    // the expression as we go, which makes them left associative; only the
+    // right operand recurses, so the depth is bounded by the number of levels
+    int precedence;
+    while ((precedence = parser_bin_op_precedence[lexer_lookahead(lexer, 1).type]) >= min_precedence) {
+        ASTOperation* operation;
+        if (parser_parse_bin_op(lexer, &operation) != E_SUCCESS) {
             return parser_error(lexer, "Expected binary operator.");
         }
 
-        // Now add the original expression we parsed earlier as the left
-        // operand expression.
-        ast_add_child(*node, left_expr);
+        // the expression so far is the left operand
+        ast_add_child(parser_arena, (ASTNode*)operation, *node);
+        *node = (ASTNode*)operation;
 
-        // Now parse the right operand expression and add it to the parent
-        // operation node.
+        // the right operand only takes operators that bind more tightly
         ASTNode* right_expr;
-        if (parser_parse_expr(lexer, &right_expr) != E_SUCCESS) {
+        if (parser_parse_bin_op_expr(lexer, &right_expr, precedence + 1) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(*node, right_expr);
-    }
-
-    // If a binary operator was not found, the left expression is the only
-    // expression and becomes the root node. This is equivalent to the non-
-    // terminal <expr_end> deriving as epsilon.
-    else {
-        *node = left_expr;
+        ast_add_child(parser_arena, *node, right_expr);
     }
 
     return E_SUCCESS;
@@ -1102,8 +1225,8 @@ Error parser_parse_expr(Lexer* lexer, ASTNode** node)
  * <expr_part> -> <location>
  *              | <method_call>
  *              | <literal>
- *              | - <expr>
- *              | ! <expr>
+ *              | - <expr_part>
+ *              | ! <expr_part>
  *              | ( <expr> )
  */
 Error parser_parse_expr_part(Lexer* lexer, ASTNode** node)
@@ -1134,20 +1257,20 @@ Error parser_parse_expr_part(Lexer* lexer, ASTNode** node)
         lexer_next(lexer);
 
         // create a unary expression node
-        *node = ast_create_node(AST_UNARY_OP, lexer->context->file);
-        ((ASTOperation*)*node)->operator = next_token.lexeme;
+        *node = ast_create_node(parser_arena, AST_UNARY_OP, lexer->context->file);
+        ((ASTOperation*)*node)->operator = next_token.type == T_MINUS ? OP_NEGATE : OP_NOT;
 
         // set line and column
-        (*node)->line = next_token.line;
-        (*node)->column = next_token.column;
+        (*node)->line = token_line(next_token);
+        (*node)->column = token_column(next_token);
 
-        // Parse a sub-expression and add it as the only child of the unary
-        // operation node.
+        // Parse the operand and add it as the only child of the unary
+        // operation node. Unary operators bind tighter than any binary one.
         ASTNode* expr;
-        if (parser_parse_expr(lexer, &expr) != E_SUCCESS) {
+        if (parser_parse_expr_part(lexer, &expr) != E_SUCCESS) {
             return parser_error(lexer, "Expected expression.");
         }
-        ast_add_child(*node, expr);
+        ast_add_child(parser_arena, *node, expr);
 
         return E_SUCCESS;
     }
@@ -1167,6 +1290,12 @@ Error parser_parse_expr_part(Lexer* lexer, ASTNode** node)
         return E_SUCCESS;
     }
 
+    // nothing else can start an expression
+    if (next_token.type != T_INT_LITERAL && next_token.type != T_CHAR_LITERAL && next_token.type != T_BOOLEAN_LITERAL) {
+        lexer_next(lexer);
+        return parser_error(lexer, "Expected expression.");
+    }
+
     // third derivation - a simple literal
     if (parser_parse_literal(lexer, node) != E_SUCCESS) {
         return parser_error(lexer, "Expected literal expression.");
@@ -1208,14 +1337,14 @@ Error parser_parse_bin_op(Lexer* lexer, ASTOperation** node)
     }
 
     // create a binary op node
-    *node = ast_create_node(AST_BINARY_OP, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_BINARY_OP, lexer->context->file);
 
     // set line and column
-    ((ASTNode*)*node)->line = token.line;
-    ((ASTNode*)*node)->column = token.column;
+    ((ASTNode*)*node)->line = token_line(token);
+    ((ASTNode*)*node)->column = token_column(token);
 
-    // get the operator from the token lexeme
-    (*node)->operator = token.lexeme;
+    // get the operator the token stands for
+    (*node)->operator = parser_operators[token.type];
 
     return E_SUCCESS;
 }
@@ -1249,7 +1378,7 @@ Error parser_parse_literal(Lexer* lexer, ASTNode** node)
 /**
  * <id> -> <alpha> <alpha_num_string>
  */
-Error parser_parse_id(Lexer* lexer, char** identifier)
+Error parser_parse_id(Lexer* lexer, const char** identifier)
 {
     Token token = lexer_next(lexer);
 
@@ -1257,7 +1386,7 @@ Error parser_parse_id(Lexer* lexer, char** identifier)
         return E_PARSE_ERROR;
     }
 
-    *identifier = token.lexeme;
+    *identifier = intern_get(token.value);
     return E_SUCCESS;
 }
 
@@ -1272,16 +1401,16 @@ Error parser_parse_int_literal(Lexer* lexer, ASTNode** node)
     }
 
     // create a node
-    *node = ast_create_node(AST_INT_LITERAL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_INT_LITERAL, lexer->context->file);
     (*node)->type = TYPE_INT;
 
     // set line and column
-    (*node)->line = token.line;
-    (*node)->column = token.column;
+    (*node)->line = token_line(token);
+    (*node)->column = token_column(token);
 
-    // get the actual int value
-    (*node)->value = malloc(sizeof(int));
-    *(int*)(*node)->value = parser_str_to_long(token.lexeme);
+    // the lexer already worked out the value; keep literals that are too
+    // large out of range even when negated so the analyzer can report them
+    (*node)->value.int_value = token.overflow ? LONG_MAX : (long)token.value;
 
     return E_SUCCESS;
 }
@@ -1297,20 +1426,15 @@ Error parser_parse_bool_literal(Lexer* lexer, ASTNode** node)
     }
 
     // create a node
-    *node = ast_create_node(AST_BOOLEAN_LITERAL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_BOOLEAN_LITERAL, lexer->context->file);
     (*node)->type = TYPE_BOOLEAN;
 
     // set line and column
-    (*node)->line = token.line;
-    (*node)->column = token.column;
+    (*node)->line = token_line(token);
+    (*node)->column = token_column(token);
 
     // get the actual boolean value
-    (*node)->value = malloc(sizeof(bool));
-    if (strcmp(token.lexeme, "true") == 0) {
-        *(bool*)(*node)->value = true;
-    } else {
-        *(bool*)(*node)->value = false;
-    }
+    (*node)->value.bool_value = lexer_token_matches(lexer, token, "true");
 
     return E_SUCCESS;
 }
@@ -1326,15 +1450,15 @@ Error parser_parse_char_literal(Lexer* lexer, ASTNode** node)
     }
 
     // create a node
-    *node = ast_create_node(AST_CHAR_LITERAL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_CHAR_LITERAL, lexer->context->file);
     (*node)->type = TYPE_CHAR;
 
     // set line and column
-    (*node)->line = token.line;
-    (*node)->column = token.column;
+    (*node)->line = token_line(token);
+    (*node)->column = token_column(token);
 
-    // get the actual value
-    (*node)->value = parser_strip_quotes(token.lexeme);
+    // the lexer already decoded the literal into the string pool
+    (*node)->value.char_value = intern_get(token.value)[0];
 
     return E_SUCCESS;
 }
@@ -1350,15 +1474,15 @@ Error parser_parse_string_literal(Lexer* lexer, ASTNode** node)
     }
 
     // create a node
-    *node = ast_create_node(AST_STRING_LITERAL, lexer->context->file);
+    *node = ast_create_node(parser_arena, AST_STRING_LITERAL, lexer->context->file);
     (*node)->type = TYPE_STRING;
 
     // set line and column
-    (*node)->line = token.line;
-    (*node)->column = token.column;
+    (*node)->line = token_line(token);
+    (*node)->column = token_column(token);
 
-    // get the actual value
-    (*node)->value = parser_strip_quotes(token.lexeme);
+    // the lexer already decoded the literal into the string pool
+    (*node)->value.string_value = intern_get(token.value);
 
     return E_SUCCESS;
 }
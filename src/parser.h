@@ -2,21 +2,27 @@
 #define WALRUS_PARSER_H
 
 #include <stdbool.h>
+#include "arena.h"
 #include "ast.h"
 #include "lexer.h"
 #include "tokens.h"
 
+// the most tokens the parser ever looks ahead of the current token
+#define PARSER_MAX_LOOKAHEAD 3
+
 
 /**
  * Parses the tokens yielded by a given lexer.
  *
  * @param  lexer The lexer to read tokens to parse from.
- * @return       An error code.
+ * @param  arena The arena to allocate the syntax tree from.
+ * @return       The root node of the syntax tree.
  */
-ASTNode* parser_parse(Lexer* lexer);
+ASTNode* parser_parse(Lexer* lexer, Arena* arena);
 
 /**
- * Displays a parser error.
+ * Displays a parser error, unless the parser is still recovering from an
+ * earlier one.
  *
  * @param  lexer   The active lexer.
  * @param  message The error message.
@@ -25,21 +31,24 @@ ASTNode* parser_parse(Lexer* lexer);
 Error parser_error(Lexer* lexer, char* message);
 
 /**
- * Tries to parse a numerical string and returns its value.
+ * Recovers from a syntax error in a statement by skipping tokens until the
+ * parser is back in sync: past the next ;, or up to the next token that starts
+ * a statement or ends the block.
  *
- * @param  string The string containing a number in decimal or hexadecimal format.
- * @return        The parsed value in decimal, or zero if it could not be parsed.
+ * @param lexer The active lexer.
+ * @param start The index of the current token before the statement was parsed.
  */
-long parser_str_to_long(char* string);
+void parser_sync_statement(Lexer* lexer, long int start);
 
 /**
- * Creates a copy of a string with single and double quotes stripped from the
- * ends of the string.
+ * Recovers from a syntax error in a field or method declaration by skipping
+ * tokens, and any blocks, until the parser is back in sync: past the next ;,
+ * or up to the next token that starts a member or ends the class.
  *
- * @param  string The string to strip.
- * @return        The stripped string.
+ * @param lexer The active lexer.
+ * @param start The index of the current token before the member was parsed.
  */
-char* parser_strip_quotes(const char* string);
+void parser_sync_member(Lexer* lexer, long int start);
 
 /**
  * Parses a program.
@@ -97,6 +106,18 @@ Error parser_parse_field_decl(Lexer* lexer, ASTDecl* program);
  */
 Error parser_parse_field_id_list(Lexer* lexer, DataType type, ASTDecl* program);
 
+/**
+ * Parses a single field identifier in a field identifier list.
+ *
+ * <id> <array_dim_decl>
+ *
+ * @param  lexer   The lexer to parse tokens from.
+ * @param  type    The data type inherited from from the field declaration.
+ * @param  program The parent node of the current position.
+ * @return         An error code.
+ */
+Error parser_parse_field_id(Lexer* lexer, DataType type, ASTDecl* program);
+
 /**
  * Parses an array delimiter declaration and retrieves the array length.
  *
@@ -338,7 +359,7 @@ Error parser_parse_callout_arg_list(Lexer* lexer, ASTReference* parent);
  * @param  identifier A pointer to where to store the identifier name.
  * @return            An error code.
  */
-Error parser_parse_method_name(Lexer* lexer, char** identifier);
+Error parser_parse_method_name(Lexer* lexer, const char** identifier);
 
 /**
  * Parses a variable location.
@@ -363,12 +384,13 @@ Error parser_parse_location(Lexer* lexer, ASTReference** node);
 Error parser_parse_array_subscript_expr(Lexer* lexer, ASTReference* parent);
 
 /**
- * Recursively parses a generic expression.
+ * Parses a generic expression.
  *
- * Note that this function parses the following 2 grammar rules at once:
+ * <expr> -> <expr_part> | <expr> <bin_op> <expr>
  *
- * <expr> -> <expr_part> <expr_end>
- * <expr_end> -> <bin_op> <expr> | EPSILON
+ * Binary operators are parsed by precedence climbing. From loosest to tightest
+ * binding, the levels are ||, &&, == !=, < <= > >=, + - and * / %. Operators on
+ * the same level are left associative, so a - b - c is (a - b) - c.
  *
  * @param  lexer The lexer to parse tokens from.
  * @param  node  A pointer to where to store the created node.
@@ -376,14 +398,25 @@ Error parser_parse_array_subscript_expr(Lexer* lexer, ASTReference* parent);
  */
 Error parser_parse_expr(Lexer* lexer, ASTNode** node);
 
+/**
+ * Parses an expression containing only binary operators with at least the
+ * given precedence, from || (1) up to * / % (6).
+ *
+ * @param  lexer          The lexer to parse tokens from.
+ * @param  node           A pointer to where to store the created node.
+ * @param  min_precedence The loosest binding operator precedence to accept.
+ * @return                An error code.
+ */
+Error parser_parse_bin_op_expr(Lexer* lexer, ASTNode** node, int min_precedence);
+
 /**
  * Parses the left operand of an expression.
  *
  * <expr_part> -> <location>
  *              | <method_call>
  *              | <literal>
- *              | - <expr>
- *              | ! <expr>
+ *              | - <expr_part>
+ *              | ! <expr_part>
  *              | ( <expr> )
  *
  * @param  lexer The lexer to parse tokens from.
@@ -434,7 +467,7 @@ Error parser_parse_literal(Lexer* lexer, ASTNode** node);
  * @param  identifier A pointer to where to store the identifier name.
  * @return            An error code.
  */
-Error parser_parse_id(Lexer* lexer, char** identifier);
+Error parser_parse_id(Lexer* lexer, const char** identifier);
 
 /**
  * Parses an integer literal.
@@ -0,0 +1,242 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ast.h"
+#include "pass_manager.h"
+
+// initial number of passes a pass manager has room for
+#define PASS_MANAGER_INITIAL_CAPACITY 8
+
+
+struct PassManager {
+    /**
+     * The passes to run, in order.
+     */
+    Pass* passes;
+
+    /**
+     * The seconds spent in each pass.
+     */
+    double* elapsed;
+
+    /**
+     * Indicates if each pass ran.
+     */
+    bool* ran;
+
+    /**
+     * The number of passes.
+     */
+    size_t count;
+
+    /**
+     * The number of passes there is room for.
+     */
+    size_t capacity;
+
+    /**
+     * The number of visits of the tree made so far.
+     */
+    int visits;
+
+    /**
+     * The seconds spent running passes, visits included.
+     */
+    double total;
+
+    /**
+     * Indicates if the time spent in each pass is measured.
+     */
+    bool timed;
+};
+
+
+/**
+ * Creates an empty pass manager.
+ */
+PassManager* pass_manager_create(bool timed)
+{
+    PassManager* manager = malloc(sizeof(PassManager));
+    manager->capacity = PASS_MANAGER_INITIAL_CAPACITY;
+    manager->passes = malloc(sizeof(Pass) * manager->capacity);
+    manager->elapsed = malloc(sizeof(double) * manager->capacity);
+    manager->ran = malloc(sizeof(bool) * manager->capacity);
+    manager->count = 0;
+    manager->visits = 0;
+    manager->total = 0;
+    manager->timed = timed;
+
+    return manager;
+}
+
+/**
+ * Adds a pass to run after all passes added before it.
+ */
+Error pass_manager_add(PassManager* manager, Pass pass)
+{
+    // make sure pointer isn't null
+    if (manager == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    // reallocate if full
+    if (manager->count >= manager->capacity) {
+        manager->capacity <<= 1;
+        manager->passes = realloc(manager->passes, sizeof(Pass) * manager->capacity);
+        manager->elapsed = realloc(manager->elapsed, sizeof(double) * manager->capacity);
+        manager->ran = realloc(manager->ran, sizeof(bool) * manager->capacity);
+    }
+
+    manager->passes[manager->count] = pass;
+    manager->elapsed[manager->count] = 0;
+    manager->ran[manager->count] = false;
+    manager->count++;
+
+    return E_SUCCESS;
+}
+
+/**
+ * Runs the passes in the given range over a tree in a single visit. Returns
+ * the first error from the visit or from finishing a pass.
+ */
+static Error pass_manager_run_fused(PassManager* manager, ASTNode* root, size_t first, size_t last)
+{
+    ASTVisitor visitors[last - first];
+    size_t count = 0;
+    Error result = E_SUCCESS;
+
+    // start each pass, leaving out those that don't want to run
+    for (size_t i = first; i < last; i++) {
+        Pass* pass = &manager->passes[i];
+        double start = manager->timed ? pass_manager_now() : 0;
+
+        if (pass->begin != NULL && pass->begin(root, pass->context) != E_SUCCESS) {
+            continue;
+        }
+        manager->ran[i] = true;
+
+        visitors[count++] = (ASTVisitor){
+            pass->pre,
+            pass->post,
+            pass->context,
+            manager->timed ? &manager->elapsed[i] : NULL
+        };
+
+        if (manager->timed) {
+            manager->elapsed[i] += pass_manager_now() - start;
+        }
+    }
+
+    // visit the tree only if any pass needs it
+    size_t visiting = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (visitors[i].pre != NULL || visitors[i].post != NULL) {
+            visiting++;
+        }
+    }
+    if (visiting > 0) {
+        result = ast_visit(root, visitors, count);
+        manager->visits++;
+    }
+
+    // finish the passes that ran
+    for (size_t i = first; i < last; i++) {
+        Pass* pass = &manager->passes[i];
+        if (!manager->ran[i] || pass->end == NULL) {
+            continue;
+        }
+
+        // every pass that ran still gets to clean up after itself
+        double start = manager->timed ? pass_manager_now() : 0;
+        Error ended = pass->end(root, pass->context);
+        if (result == E_SUCCESS) {
+            result = ended;
+        }
+        if (manager->timed) {
+            manager->elapsed[i] += pass_manager_now() - start;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Runs all passes over a tree in order.
+ */
+Error pass_manager_run(PassManager* manager, ASTNode* root)
+{
+    // make sure pointer isn't null
+    if (manager == NULL || root == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    double start = manager->timed ? pass_manager_now() : 0;
+    Error result = E_SUCCESS;
+
+    // run each pass together with the fusable passes right after it, up to one
+    // that rewrites the tree
+    size_t first = 0;
+    while (first < manager->count) {
+        size_t last = first + 1;
+        while (last < manager->count && manager->passes[last].fusable && !manager->passes[last].rewrites) {
+            last++;
+        }
+
+        Error ran = pass_manager_run_fused(manager, root, first, last);
+        if (result == E_SUCCESS) {
+            result = ran;
+        }
+        first = last;
+    }
+
+    if (manager->timed) {
+        manager->total += pass_manager_now() - start;
+    }
+
+    return result;
+}
+
+/**
+ * Writes the time spent in each pass that has run.
+ */
+void pass_manager_write_timings(PassManager* manager, FILE* stream)
+{
+    for (size_t i = 0; i < manager->count; i++) {
+        if (manager->ran[i]) {
+            fprintf(stream, "%-12s %10.3f ms\n", manager->passes[i].name, manager->elapsed[i] * 1e3);
+        }
+    }
+
+    fprintf(stream, "%-12s %10.3f ms, %d %s of the tree\n",
+        "total", manager->total * 1e3, manager->visits, manager->visits == 1 ? "visit" : "visits");
+}
+
+/**
+ * Gets the current time in seconds.
+ */
+double pass_manager_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+/**
+ * Destroys a pass manager.
+ */
+Error pass_manager_destroy(PassManager** manager)
+{
+    // make sure pointer isn't null
+    if (manager == NULL || *manager == NULL) {
+        return E_BAD_POINTER;
+    }
+
+    free((*manager)->passes);
+    free((*manager)->elapsed);
+    free((*manager)->ran);
+    free(*manager);
+    *manager = NULL;
+
+    return E_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#ifndef WALRUS_PASS_MANAGER_H
+#define WALRUS_PASS_MANAGER_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "ast.h"
+#include "error.h"
+
+
+/**
+ * A pass over an abstract syntax tree.
+ */
+typedef struct {
+    /**
+     * A short name for the pass, used when reporting timings.
+     */
+    const char* name;
+
+    /**
+     * Indicates if the pass can share a visit with the passes before it.
+     *
+     * A pass can be fused with earlier passes if it only ever looks at nodes
+     * the earlier passes are already done with; that is, the node being
+     * visited and everything below it.
+     */
+    bool fusable;
+
+    /**
+     * Indicates if the pass puts new nodes in the place of the ones it visits.
+     *
+     * Passes fused before it would already have seen the old nodes, so such a
+     * pass only ever shares a visit with the passes after it, whether it is
+     * fusable or not.
+     */
+    bool rewrites;
+
+    /**
+     * Called before the tree is visited, if not NULL. If it returns anything
+     * other than E_SUCCESS, the pass is left out.
+     */
+    Error (*begin)(ASTNode* root, void* context);
+
+    /**
+     * Called on each node before its children, if not NULL.
+     */
+    ASTVisitFunction pre;
+
+    /**
+     * Called on each node after its children, if not NULL.
+     */
+    ASTVisitFunction post;
+
+    /**
+     * Called after the tree is visited, if not NULL. An error it returns is
+     * passed on by pass_manager_run().
+     */
+    Error (*end)(ASTNode* root, void* context);
+
+    /**
+     * The value to pass along to the functions.
+     */
+    void* context;
+} Pass;
+
+/**
+ * Runs a sequence of passes over a tree, with as few visits as possible.
+ */
+typedef struct PassManager PassManager;
+
+/**
+ * Creates an empty pass manager.
+ *
+ * @param  timed Indicates if the time spent in each pass should be measured.
+ * @return       A shiny new pass manager.
+ */
+PassManager* pass_manager_create(bool timed);
+
+/**
+ * Adds a pass to run after all passes added before it.
+ *
+ * @param  manager The pass manager.
+ * @param  pass    The pass to add.
+ * @return         An error code.
+ */
+Error pass_manager_add(PassManager* manager, Pass pass);
+
+/**
+ * Runs all passes over a tree in order.
+ *
+ * Each run of passes that can be fused shares a single visit of the tree; a
+ * run ends before every pass that isn't fusable or that rewrites the tree.
+ * Later passes still run after a pass fails.
+ *
+ * @param  manager The pass manager.
+ * @param  root    The root node of the tree.
+ * @return         The first error from visiting the tree or ending a pass.
+ */
+Error pass_manager_run(PassManager* manager, ASTNode* root);
+
+/**
+ * Writes the time spent in each pass that has run.
+ *
+ * @param  manager The pass manager.
+ * @param  stream  The stream to write to.
+ */
+void pass_manager_write_timings(PassManager* manager, FILE* stream);
+
+/**
+ * Gets the time on the clock that pass timings are measured with.
+ *
+ * @return The current time in seconds.
+ */
+double pass_manager_now(void);
+
+/**
+ * Destroys a pass manager.
+ *
+ * @param  manager The pass manager to destroy.
+ * @return         An error code.
+ */
+Error pass_manager_destroy(PassManager** manager);
+
+#endif
@@ -1,105 +1,439 @@
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "error.h"
 #include "scanner.h"
 
+// number of bytes to read at a time from files that can't be mapped
+#define SCANNER_CHUNK_SIZE 65536
+
+// the most sources that can be opened, since tokens store a 16-bit source id
+#define SCANNER_MAX_SOURCES UINT16_MAX
+
+// the largest source that can be read, since tokens store a 32-bit offset
+#define SCANNER_MAX_SIZE (UINT32_MAX - SCANNER_CHUNK_SIZE)
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+/**
+ * All scanner contexts ever opened, indexed by id. Closed contexts are NULL.
+ */
+static ScannerContext** scanner_sources = NULL;
+static unsigned int scanner_source_count = 0;
+
+
+/**
+ * Registers a scanner context as a new source so tokens can find their way
+ * back to it.
+ */
+static void scanner_register(ScannerContext* context)
+{
+    assert(scanner_source_count <= SCANNER_MAX_SOURCES);
+    scanner_sources = realloc(scanner_sources, sizeof(ScannerContext*) * (scanner_source_count + 1));
+    scanner_sources[scanner_source_count] = context;
+    context->id = scanner_source_count++;
+}
+
+/**
+ * Creates a scanner context with default position values.
+ */
+static ScannerContext* scanner_create_context(char* file)
+{
+    ScannerContext* context = (ScannerContext*)malloc(sizeof(ScannerContext));
+    context->id = 0;
+    context->messages = stdout;
+
+    // the first line always starts at the beginning
+    context->line_capacity = 64;
+    context->line_starts = malloc(sizeof(long int) * context->line_capacity);
+    context->line_starts[0] = 0;
+    context->line_count = 1;
+    context->line_first = 0;
+    context->line_indexed = 0;
+
+    context->file = file;
+    context->eof = false;
+    context->buffer = NULL;
+    context->base = 0;
+    context->released = 0;
+    context->position = 0;
+    context->mapped = false;
+    context->allocated = false;
+    context->size = 0;
+    context->capacity = 0;
+    context->fd = -1;
+    return context;
+}
+
+#if defined(__AVX2__)
+// scan 32 bytes at a time
+#define SCANNER_BLOCK_SIZE 32
+#define SCANNER_BLOCK_MASK 0xFFFFFFFFu
+
+/**
+ * Gets a bit mask of the line feeds in a block of source text.
+ */
+static inline uint32_t scanner_newline_mask(const char* block)
+{
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)block);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+}
+
+/**
+ * Gets a bit mask of the whitespace characters in a block of source text.
+ */
+static inline uint32_t scanner_whitespace_mask(const char* block)
+{
+    __m256i bytes = _mm256_loadu_si256((const __m256i*)block);
+
+    // \t, \n, \v, \f and \r are the contiguous range 9-13; \f is not whitespace
+    __m256i control = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+    __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(control, _mm256_set1_epi8(4)), control);
+    __m256i is_feed = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\f'));
+    __m256i is_space = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' '));
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_andnot_si256(is_feed, is_control), is_space));
+}
+#elif defined(__SSE2__)
+// scan 16 bytes at a time
+#define SCANNER_BLOCK_SIZE 16
+#define SCANNER_BLOCK_MASK 0xFFFFu
+
+/**
+ * Gets a bit mask of the line feeds in a block of source text.
+ */
+static inline uint32_t scanner_newline_mask(const char* block)
+{
+    __m128i bytes = _mm_loadu_si128((const __m128i*)block);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+}
+
+/**
+ * Gets a bit mask of the whitespace characters in a block of source text.
+ */
+static inline uint32_t scanner_whitespace_mask(const char* block)
+{
+    __m128i bytes = _mm_loadu_si128((const __m128i*)block);
+
+    // \t, \n, \v, \f and \r are the contiguous range 9-13; \f is not whitespace
+    __m128i control = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+    __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(control, _mm_set1_epi8(4)), control);
+    __m128i is_feed = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\f'));
+    __m128i is_space = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' '));
+
+    return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_andnot_si128(is_feed, is_control), is_space));
+}
+#endif
+
+/**
+ * Checks if a character is whitespace that the lexer skips over.
+ */
+static inline bool scanner_is_whitespace(char character)
+{
+    return character == ' ' || character == '\t' || character == '\n'
+        || character == '\v' || character == '\r';
+}
+
+/**
+ * Gets the number of whitespace characters at the start of a span of text.
+ */
+static long int scanner_span_whitespace(const char* text, long int length)
+{
+    long int i = 0;
+
+#ifdef SCANNER_BLOCK_SIZE
+    // look for the first non-whitespace character a block at a time
+    for (; i + SCANNER_BLOCK_SIZE <= length; i += SCANNER_BLOCK_SIZE) {
+        uint32_t mask = ~scanner_whitespace_mask(text + i) & SCANNER_BLOCK_MASK;
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    // scan whatever is left one character at a time
+    while (i < length && scanner_is_whitespace(text[i])) {
+        i++;
+    }
+
+    return i;
+}
+
+/**
+ * Gets the index of the first line feed in a span of text, or the length of
+ * the span if there is none.
+ */
+static long int scanner_find_newline(const char* text, long int length)
+{
+    long int i = 0;
+
+#ifdef SCANNER_BLOCK_SIZE
+    for (; i + SCANNER_BLOCK_SIZE <= length; i += SCANNER_BLOCK_SIZE) {
+        uint32_t mask = scanner_newline_mask(text + i);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    while (i < length && text[i] != '\n') {
+        i++;
+    }
+
+    return i;
+}
+
+/**
+ * Makes sure a number of bytes past the current position are in the buffer.
+ *
+ * Input is appended to the buffer in large blocks. The buffer only grows if
+ * the part of the source still in use doesn't fit; see scanner_release().
+ */
+bool scanner_fill(ScannerContext* context, long int count)
+{
+    while (context->position + count > context->size) {
+        // no more input to read
+        if (context->fd < 0) {
+            return false;
+        }
+
+        // token offsets are 32 bits wide
+        if (context->size >= SCANNER_MAX_SIZE) {
+            error(E_OPERATION_FAILED, "The input '%s' is too large.", context->file);
+            if (context->fd != STDIN_FILENO) {
+                close(context->fd);
+            }
+            context->fd = -1;
+            return false;
+        }
+
+        // make sure there is room for a whole block
+        long int used = context->size - context->base;
+        if (context->capacity - used < SCANNER_CHUNK_SIZE) {
+            long int capacity = context->capacity > 0 ? context->capacity * 2 : SCANNER_CHUNK_SIZE;
+            char* buffer = realloc((void*)context->buffer, capacity);
+            if (buffer == NULL) {
+                error(E_OPERATION_FAILED, "Out of memory reading '%s'.", context->file);
+                if (context->fd != STDIN_FILENO) {
+                    close(context->fd);
+                }
+                context->fd = -1;
+                return false;
+            }
+            context->buffer = buffer;
+            context->capacity = capacity;
+        }
+
+        ssize_t bytes = read(context->fd, (char*)context->buffer + used, context->capacity - used);
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+
+        // end of input, or an error we can't do anything about
+        if (bytes <= 0) {
+            if (bytes < 0) {
+                error(E_OPERATION_FAILED, "Error reading from '%s'.", context->file);
+            }
+            if (context->fd != STDIN_FILENO) {
+                close(context->fd);
+            }
+            context->fd = -1;
+            return false;
+        }
+
+        context->size += bytes;
+    }
+
+    return true;
+}
+
+/**
+ * Records that a new line starts at the given offset.
+ */
+static inline void scanner_add_line(ScannerContext* context, long int offset)
+{
+    if (context->line_count == context->line_capacity) {
+        context->line_capacity *= 2;
+        context->line_starts = realloc(context->line_starts, sizeof(long int) * context->line_capacity);
+    }
+
+    context->line_starts[context->line_count++] = offset;
+}
+
+/**
+ * Extends the line index to cover all the source up to a given offset, finding
+ * line feeds a block at a time.
+ */
+static void scanner_index_lines(ScannerContext* context, long int offset)
+{
+    long int i = context->line_indexed;
+
+#ifdef SCANNER_BLOCK_SIZE
+    for (; i + SCANNER_BLOCK_SIZE <= offset; i += SCANNER_BLOCK_SIZE) {
+        // add a line for every bit set in the mask, lowest first
+        uint32_t mask = scanner_newline_mask(scanner_get_text(context, i));
+        for (; mask != 0; mask &= mask - 1) {
+            scanner_add_line(context, i + __builtin_ctz(mask) + 1);
+        }
+    }
+#endif
+
+    for (; i < offset; i++) {
+        if (*scanner_get_text(context, i) == '\n') {
+            scanner_add_line(context, i + 1);
+        }
+    }
+
+    context->line_indexed = offset;
+}
+
+/**
+ * Moves past a number of characters at once.
+ */
+static inline void scanner_consume(ScannerContext* context, long int count)
+{
+    // check if we have reached the end of the input
+    context->position += count;
+    if (context->position == context->size && !scanner_fill(context, 1)) {
+        context->eof = true;
+    }
+}
 
 /**
  * Opens a file in read-only mode and creates a scanner context for it.
  */
 ScannerContext* scanner_open(char* filename)
 {
+    // a dash means standard input
+    if (strcmp(filename, "-") == 0) {
+        return scanner_open_fd(STDIN_FILENO, filename);
+    }
+
     // open the given file
-    FILE* stream = fopen(filename, "rb");
-    if (stream == NULL) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
         error(E_FILE_NOT_FOUND, "The file '%s' could not be opened.", filename);
         return NULL;
     }
 
+    // only regular, non-empty files can be mapped; pipes and such are read
+    // as they come
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        return scanner_open_fd(fd, filename);
+    }
+
+    // token offsets are 32 bits wide
+    if (info.st_size > SCANNER_MAX_SIZE) {
+        close(fd);
+        error(E_OPERATION_FAILED, "The file '%s' is too large.", filename);
+        return NULL;
+    }
+
+    // map the whole file into memory
+    void* buffer = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buffer == MAP_FAILED) {
+        return scanner_open_fd(fd, filename);
+    }
+
+    // the mapping stays valid after closing the file descriptor
+    close(fd);
+
+    // we read the file front to back exactly once
+    madvise(buffer, info.st_size, MADV_SEQUENTIAL);
+
     // create a context pointer
-    ScannerContext* context = (ScannerContext*)malloc(sizeof(ScannerContext));
-    context->file = filename;
-    context->line = 1;
-    context->column = 1;
-    context->eol = false;
-    context->eof = false;
-    context->stream = stream;
+    ScannerContext* context = scanner_create_context(filename);
+    scanner_register(context);
+    context->buffer = buffer;
+    context->mapped = true;
+    context->size = info.st_size;
 
-    // find out the size of the file so we know when we have
-    // reached the end when reading later
-    fseek(context->stream, 0, SEEK_END);
-    context->size = ftell(context->stream);
-    fseek(context->stream, 0, SEEK_SET);
+    return context;
+}
+
+/**
+ * Creates a scanner context that reads from an open file descriptor a block
+ * at a time.
+ */
+ScannerContext* scanner_open_fd(int fd, char* filename)
+{
+    // create a context pointer
+    ScannerContext* context = scanner_create_context(filename);
+    scanner_register(context);
+    context->fd = fd;
+    context->allocated = true;
+
+    // read the first block up front
+    scanner_fill(context, 1);
 
     return context;
 }
 
 /**
- * Opens a string as a stream and creates a scanner context for it.
+ * Creates a scanner context that reads directly from a string.
  */
 ScannerContext* scanner_open_string(char* string)
 {
-    // create a stream for the char array
-    FILE* stream = fmemopen(string, strlen(string), "rb");
-    if (stream == NULL) {
-        error(E_FILE_NOT_FOUND, "Could not read input string.");
-        return NULL;
-    }
-
     // create a context pointer
-    ScannerContext* context = (ScannerContext*)malloc(sizeof(ScannerContext));
-    context->file = "[string]";
-    context->line = 1;
-    context->column = 1;
-    context->eol = false;
-    context->eof = false;
-    context->stream = stream;
+    ScannerContext* context = scanner_create_context("[string]");
+    scanner_register(context);
+    context->buffer = string;
     context->size = strlen(string);
 
     return context;
 }
 
+/**
+ * Creates a scanner context that reads a part of the source of another context.
+ */
+ScannerContext* scanner_open_slice(ScannerContext* source, long int start, long int end)
+{
+    assert(source->fd < 0 && start >= source->released && start <= end && end <= source->size);
+
+    // share the buffer and the id of the source, so tokens read from the slice
+    // are just like tokens read from the source
+    ScannerContext* context = scanner_create_context(source->file);
+    context->id = source->id;
+    context->buffer = source->buffer;
+    context->base = source->base;
+    context->released = source->released;
+    context->position = start;
+    context->size = end;
+
+    return context;
+}
+
 /**
  * Gets the next character in the stream.
  *
  * Does not work on multibyte characters.
  */
-char scanner_next(ScannerContext* context)
+int scanner_next(ScannerContext* context)
 {
     // report end-of-file if we finished the stream
     if (context->eof) {
         return EOF;
     }
 
-    // read the next char
-    int character = fgetc(context->stream);
-
-    // if previous char was an EOL, char is at start of next line
-    if (context->eol) {
-        context->line++;
-        context->column = 1;
-        context->eol = false;
-    } else {
-        // advance to next column
-        context->column++;
-    }
+    // read the next char; widened as unsigned so a 0xFF byte isn't EOF
+    int character = context->position < context->size || scanner_fill(context, 1)
+        ? (unsigned char)*scanner_get_text(context, context->position++)
+        : EOF;
 
-    // LF puts next char on new line; CR not recognized here
-    if (character == '\n') {
-        context->eol = true;
-    }
-
-    /* Check if we have reached the end of the stream. Note that
-     * we are comparing the current reported position in the stream
-     * with the size of the file (which was determined when it was
-     * opened). This is a workaround for a strange bug that occurs
-     * with files that don't end with a newline on Linux, where EOF
-     * is never reported and the last character is read repeatedly.
-     */
-    if (character == EOF || ftell(context->stream) == context->size) {
+    // check if we have reached the end of the input
+    if (context->position == context->size && !scanner_fill(context, 1)) {
         context->eof = true;
     }
 
@@ -111,12 +445,12 @@ char scanner_next(ScannerContext* context)
  *
  * Does not work on multibyte characters.
  */
-char scanner_advance(ScannerContext* context, long int offset)
+int scanner_advance(ScannerContext* context, long int offset)
 {
     assert(offset > 0);
 
     // current char
-    char character;
+    int character;
 
     // move next for given offset
     for (int i = 0; i < offset; ++i) {
@@ -130,74 +464,204 @@ char scanner_advance(ScannerContext* context, long int offset)
     return character;
 }
 
+/**
+ * Skips over any whitespace at the current position.
+ */
+void scanner_skip_whitespace(ScannerContext* context)
+{
+    // keep going as long as the whitespace runs up to the end of what we have
+    // read so far
+    while (!context->eof && scanner_fill(context, 1)) {
+        long int remaining = context->size - context->position;
+        long int length = scanner_span_whitespace(scanner_get_text(context, context->position), remaining);
+        scanner_consume(context, length);
+
+        if (length < remaining) {
+            break;
+        }
+    }
+}
+
+/**
+ * Skips over the rest of the current line, including the line feed.
+ */
+void scanner_skip_line(ScannerContext* context)
+{
+    // keep going until we find the line feed or run out of input
+    while (!context->eof && scanner_fill(context, 1)) {
+        long int remaining = context->size - context->position;
+        long int length = scanner_find_newline(scanner_get_text(context, context->position), remaining);
+
+        // consume the line feed as well
+        if (length < remaining) {
+            scanner_consume(context, length + 1);
+            break;
+        }
+
+        scanner_consume(context, length);
+    }
+}
+
 /**
  * Reads a character from a scanner context relative to the current position.
  */
-char scanner_peek(ScannerContext* context, long int offset)
+int scanner_peek(ScannerContext* context, long int offset)
 {
     // report end-of-file if we already are at the end
     if (context->eof) {
         return EOF;
     }
 
-    // move to offset if not zero
-    if (offset != 0 && fseek(context->stream, offset, SEEK_CUR) != 0) {
-        // seek is out of bounds
+    // reading outside the input is the same as reading past the end
+    long int position = context->position + offset;
+    if (position < 0 || (position >= context->size && !scanner_fill(context, offset + 1))) {
         return EOF;
     }
 
-    // get the character
-    char character = fgetc(context->stream);
-
-    // return to previous position
-    fseek(context->stream, -1 - offset, SEEK_CUR);
-
-    return character;
+    return (unsigned char)*scanner_get_text(context, position);
 }
 
 /**
- * Gets the string of characters between a given offset and the current position.
+ * Copies a slice of the source into a newly allocated string.
  */
-char* scanner_get_string(ScannerContext* context, long int offset)
+char* scanner_get_slice(ScannerContext* context, long int offset, long int length)
 {
     // context shouldn't be null
     assert(context != NULL);
-    assert(offset != 0);
+    assert(offset >= 0 && offset + length <= context->size);
 
-    // where are we?
-    long int position = ftell(context->stream);
-    // how many chars we will get
-    long int length = labs(offset);
-    // allocate the string
+    // allocate and copy the string
     char* string = malloc(length + 1);
+    assert(offset >= context->released);
+    memcpy(string, scanner_get_text(context, offset), length);
+    string[length] = '\0';
+
+    return string;
+}
 
-    // if offset is negative, seek backwards
-    if (offset < 0) {
-        fseek(context->stream, offset, SEEK_CUR);
+/**
+ * Gets an open scanner context by its id.
+ */
+ScannerContext* scanner_get_source(unsigned int id)
+{
+    return id < scanner_source_count ? scanner_sources[id] : NULL;
+}
+
+/**
+ * Gets the line and column the scanner was at right after reading up to a
+ * given offset.
+ *
+ * Lines are indexed lazily, only as far as positions are asked for.
+ */
+void scanner_locate(ScannerContext* context, long int offset, unsigned int* line, unsigned int* column)
+{
+    assert(offset >= context->released && offset <= context->position);
+
+    // make sure we know about every line up to the offset
+    if (offset > context->line_indexed) {
+        scanner_index_lines(context, offset);
     }
 
-    // and append current char
-    for (int i = 0; i < length; ++i) {
-        string[i] = fgetc(context->stream);
+    // nothing has been read yet
+    if (offset == 0) {
+        *line = 1;
+        *column = 1;
+        return;
     }
-    // add string terminator
-    string[length] = '\0';
 
-    // move back to original position
-    fseek(context->stream, position, SEEK_SET);
-    return string;
+    // binary search for the last line that starts at or before the character
+    long int position = offset - 1;
+    long int low = 0;
+    long int high = context->line_count - 1;
+    while (low < high) {
+        long int middle = low + (high - low + 1) / 2;
+        if (context->line_starts[middle] <= position) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    // columns on the first line are counted from 2, as they always have been
+    long int number = context->line_first + low;
+    *line = number + 1;
+    *column = position - context->line_starts[low] + (number == 0 ? 2 : 1);
+}
+
+/**
+ * Lets go of the source before an offset that nothing will read or locate
+ * again.
+ */
+void scanner_release(ScannerContext* context, long int offset)
+{
+    // keep a chunk behind the offset, so tokens the parser still holds on to
+    // can be read and located, and only let go of a chunk at a time, so the
+    // cost of moving bytes and lines around is spread out
+    long int end = offset - SCANNER_CHUNK_SIZE;
+    if (end - context->released < SCANNER_CHUNK_SIZE) {
+        return;
+    }
+
+    // find every line start before the end while the source is still there
+    if (end > context->line_indexed) {
+        scanner_index_lines(context, end);
+    }
+
+    if (context->mapped) {
+        // give back whole pages; should they be touched again, they are read
+        // back in from the file
+        long int page = sysconf(_SC_PAGESIZE);
+        long int start = context->released / page * page;
+        long int stop = end / page * page;
+        if (stop > start) {
+            madvise((char*)context->buffer + start, stop - start, MADV_DONTNEED);
+        }
+    } else if (context->allocated) {
+        // move what is still needed to the front of the buffer
+        memmove((char*)context->buffer, scanner_get_text(context, end), context->size - end);
+        context->base = end;
+    }
+    context->released = end;
+
+    // forget the lines that end before the released part does; the line the
+    // end is on stays first
+    long int count = 0;
+    while (count + 1 < context->line_count && context->line_starts[count + 1] <= end) {
+        count++;
+    }
+    if (count > 0) {
+        memmove(context->line_starts, context->line_starts + count, sizeof(long int) * (context->line_count - count));
+        context->line_count -= count;
+        context->line_first += count;
+    }
 }
 
 /**
- * Closes a scanner context and its associated input stream.
+ * Closes a scanner context and releases its source buffer.
  */
 Error scanner_close(ScannerContext** context)
 {
     // context shouldn't be null
     assert(context != NULL);
 
-    // close the stream handle
-    fclose((*context)->stream);
+    // close the input if we didn't read all of it
+    if ((*context)->fd >= 0 && (*context)->fd != STDIN_FILENO) {
+        close((*context)->fd);
+    }
+
+    // release the source buffer if we own it
+    if ((*context)->mapped) {
+        munmap((void*)(*context)->buffer, (*context)->size);
+    } else if ((*context)->allocated) {
+        free((void*)(*context)->buffer);
+    }
+
+    // tokens can't refer to this source anymore; slices share the id of their
+    // source, so leave it alone for them
+    if (scanner_sources[(*context)->id] == *context) {
+        scanner_sources[(*context)->id] = NULL;
+    }
+    free((*context)->line_starts);
 
     // free the pointer
     free(*context);
@@ -205,3 +669,13 @@ Error scanner_close(ScannerContext** context)
 
     return E_SUCCESS;
 }
+
+/**
+ * Frees the table of sources.
+ */
+void scanner_clear_sources(void)
+{
+    free(scanner_sources);
+    scanner_sources = NULL;
+    scanner_source_count = 0;
+}
@@ -11,29 +11,42 @@
  */
 typedef struct {
     /**
-     * An open file stream.
+     * The source contents from offset base onward. Tokens refer to slices of
+     * this buffer; use scanner_get_text() to find them.
      */
-    FILE* stream;
+    const char* buffer;
 
     /**
-     * The name of the file.
+     * The offset in the source of the first byte in the buffer. Only moves for
+     * sources read from a file descriptor, as the scanner lets go of them.
      */
-    char* file;
+    long int base;
+
+    /**
+     * The offset before which the source has been let go of. It can no longer
+     * be read, and positions before it can no longer be located.
+     */
+    long int released;
 
     /**
-     * The current line in the source file.
+     * The current read position in the source buffer.
      */
-    int line;
+    long int position;
 
     /**
-     * The current text column in the source file.
+     * Indicates if the buffer is a memory mapping that must be unmapped.
      */
-    int column;
+    bool mapped;
 
     /**
-     * Indicates if we are approaching the end of a line.
+     * Indicates if the buffer was allocated by the scanner and must be freed.
      */
-    bool eol;
+    bool allocated;
+
+    /**
+     * The name of the file.
+     */
+    char* file;
 
     /**
      * Indicates if we have reached the end of the file.
@@ -41,19 +54,84 @@ typedef struct {
     bool eof;
 
     /**
-     * The total number of bytes in the source file.
+     * The number of bytes of the source read into the buffer so far.
      */
     long int size;
+
+    /**
+     * The number of bytes allocated for the buffer, if it was allocated.
+     */
+    long int capacity;
+
+    /**
+     * The file descriptor more input is read from, or -1 if the whole source
+     * is already in the buffer.
+     */
+    int fd;
+
+    /**
+     * The id tokens use to refer to this source.
+     */
+    unsigned int id;
+
+    /**
+     * The stream that diagnostics about this source are printed to.
+     */
+    FILE* messages;
+
+    /**
+     * The offsets that each line starts at, in order, from line line_first
+     * on. Only lines before line_indexed have been found so far.
+     */
+    long int* line_starts;
+
+    /**
+     * The number of lines left out of line_starts because the source they are
+     * in has been let go of.
+     */
+    long int line_first;
+
+    /**
+     * The number of lines found so far.
+     */
+    long int line_count;
+
+    /**
+     * The number of line offsets allocated.
+     */
+    long int line_capacity;
+
+    /**
+     * The offset up to which the source has been searched for line starts.
+     */
+    long int line_indexed;
 } ScannerContext;
 
 /**
  * Opens a file to be scanned and returns a scanner context for the file.
  *
+ * The file is mapped into memory if possible; otherwise it is read a block at a
+ * time as with scanner_open_fd(). A file name of "-" reads standard input.
+ *
  * @param  filename The name of the file to open.
  * @return          A new scanner context.
  */
 ScannerContext* scanner_open(char* filename);
 
+/**
+ * Creates a scanner context that reads from an open file descriptor, such as a
+ * pipe or standard input.
+ *
+ * Input is read in large blocks as the scanner needs it, and stays in memory
+ * until scanner_release() lets go of it. The scanner takes ownership of the
+ * file descriptor, except for standard input.
+ *
+ * @param  fd       The file descriptor to read from.
+ * @param  filename The name to use for the input in messages.
+ * @return          A new scanner context.
+ */
+ScannerContext* scanner_open_fd(int fd, char* filename);
+
 /**
  * Creates a scanner context for reading from a string.
  *
@@ -62,40 +140,133 @@ ScannerContext* scanner_open(char* filename);
  */
 ScannerContext* scanner_open_string(char* string);
 
+/**
+ * Creates a scanner context that reads only a part of the source of another
+ * context, which must be entirely in memory already.
+ *
+ * The slice shares the buffer and the id of its source, so offsets and tokens
+ * are the same as when reading the source itself. Closing the slice leaves the
+ * source alone.
+ *
+ * @param  source The scanner context to take a slice of.
+ * @param  start  The offset the slice starts at.
+ * @param  end    The offset the slice ends at; the slice reports end-of-file
+ *                there.
+ * @return        A new scanner context.
+ */
+ScannerContext* scanner_open_slice(ScannerContext* source, long int start, long int end);
+
+/**
+ * Makes sure a number of bytes past the current position have been read into
+ * the buffer, reading more input if needed.
+ *
+ * @param  context An open scanner context.
+ * @param  count   The number of bytes needed.
+ * @return         True if the bytes are available, or false if the input ends
+ *                 before then.
+ */
+bool scanner_fill(ScannerContext* context, long int count);
+
 /**
  * Reads a next character from a scanner context and advances to the next character.
  *
  * @param  context An open scanner context.
- * @return         The next character in the stream.
+ * @return         The next character in the stream as an unsigned char, or EOF
+ *                 at the end of the stream.
  */
-char scanner_next(ScannerContext* context);
+int scanner_next(ScannerContext* context);
 
 /**
  * Advances the scanner ahead by a number of characters.
  *
  * @param  context An open scanner context.
  * @param  offset  The number of characters to advance from the current position.
- * @return         The last character advanced past.
+ * @return         The last character advanced past as an unsigned char, or EOF
+ *                 if the end of the stream was reached.
+ */
+int scanner_advance(ScannerContext* context, long int offset);
+
+/**
+ * Skips over any whitespace at the current position, many characters at a time.
+ *
+ * @param context An open scanner context.
  */
-char scanner_advance(ScannerContext* context, long int offset);
+void scanner_skip_whitespace(ScannerContext* context);
+
+/**
+ * Skips over the rest of the current line, including its line feed, many
+ * characters at a time.
+ *
+ * @param context An open scanner context.
+ */
+void scanner_skip_line(ScannerContext* context);
 
 /**
  * Reads a character from a scanner context relative to the current position.
  *
  * @param  context An open scanner context.
  * @param  offset  The character offset from the current position.
- * @return         The next character in the stream.
+ * @return         The character at the offset as an unsigned char, or EOF if
+ *                 the offset is outside the stream.
  */
-char scanner_peek(ScannerContext* context, long int offset);
+int scanner_peek(ScannerContext* context, long int offset);
 
 /**
- * Gets the string of characters between a given offset and the current position.
+ * Gets a pointer to the source text at an offset that is in memory.
  *
  * @param  context An open scanner context.
- * @param  offset  The character offset from the current position.
+ * @param  offset  The byte offset from the start of the source; no less than
+ *                 where the source has been let go of.
+ * @return         A pointer into the buffer.
+ */
+static inline const char* scanner_get_text(ScannerContext* context, long int offset)
+{
+    return context->buffer + (offset - context->base);
+}
+
+/**
+ * Lets go of the source before an offset that nothing will read or locate
+ * again, so memory use stays the same no matter how long the source is.
+ *
+ * Nothing happens until there is a good amount to let go of, and some of the
+ * source right before the offset is always kept. Read input is moved to the
+ * front of its buffer, and pages of a mapped file are given back to the
+ * system. Line starts before the offset are forgotten as well.
+ *
+ * @param context An open scanner context.
+ * @param offset  The offset before which the source isn't needed.
+ */
+void scanner_release(ScannerContext* context, long int offset);
+
+/**
+ * Copies a slice of the source into a newly allocated string.
+ *
+ * @param  context An open scanner context.
+ * @param  offset  The byte offset of the slice from the start of the source.
+ * @param  length  The number of bytes in the slice.
  * @return         A string of characters.
  */
-char* scanner_get_string(ScannerContext* context, long int offset);
+char* scanner_get_slice(ScannerContext* context, long int offset, long int length);
+
+/**
+ * Gets an open scanner context by its id.
+ *
+ * @param  id The id of the scanner context.
+ * @return    The scanner context, or NULL if it has been closed.
+ */
+ScannerContext* scanner_get_source(unsigned int id);
+
+/**
+ * Gets the line and column the scanner was at right after reading up to a
+ * given offset, which is the position of the last character before it.
+ *
+ * @param context An open scanner context.
+ * @param offset  An offset in the source no greater than the current position,
+ *                and not before where the source has been let go of.
+ * @param line    Set to the line number.
+ * @param column  Set to the column number.
+ */
+void scanner_locate(ScannerContext* context, long int offset, unsigned int* line, unsigned int* column);
 
 /**
  * Closes a scanner context.
@@ -105,4 +276,10 @@ char* scanner_get_string(ScannerContext* context, long int offset);
  */
 Error scanner_close(ScannerContext** context);
 
+/**
+ * Forgets all sources ever opened. Any sources still open can no longer be
+ * found by their id.
+ */
+void scanner_clear_sources(void);
+
 #endif
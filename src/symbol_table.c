@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "error.h"
+#include "intern.h"
 #include "symbol_table.h"
 #include "types.h"
 
@@ -74,7 +75,7 @@ Error symbol_table_end_scope(SymbolTable* table)
 /**
  * Checks if a symbol already exists only in the current scope.
  */
-bool symbol_table_exists_local(SymbolTable* table, char* symbol)
+bool symbol_table_exists_local(SymbolTable* table, const char* symbol)
 {
     // can't exist if no scope t look in
     if (table->stack_top == NULL) {
@@ -88,7 +89,7 @@ bool symbol_table_exists_local(SymbolTable* table, char* symbol)
     // the hash's location
     for (SymbolEntry* entry = table->stack_top->map->entries[hash]; entry != NULL; entry = entry->next) {
         // check if the current entry matches the symbol we are looking for
-        if (strcmp(entry->symbol, symbol) == 0) {
+        if (entry->symbol == symbol) {
             // we finally found it!
             return true;
         }
@@ -105,7 +106,7 @@ bool symbol_table_exists_local(SymbolTable* table, char* symbol)
  * the scope stack. Yeah, not terribly efficient, is it? Just look at those nasty
  * nested for loops. Worst case is pretty bad, but average case isn't too shabby.
  */
-SymbolEntry* symbol_table_lookup(SymbolTable* table, char* symbol)
+SymbolEntry* symbol_table_lookup(SymbolTable* table, const char* symbol)
 {
     // get the symbol hash first
     unsigned int hash = symbol_hash(symbol);
@@ -116,7 +117,7 @@ SymbolEntry* symbol_table_lookup(SymbolTable* table, char* symbol)
         // the hash's location
         for (SymbolEntry* entry = scope->map->entries[hash]; entry != NULL; entry = entry->next) {
             // check if the current entry matches the symbol we are looking for
-            if (strcmp(entry->symbol, symbol) == 0) {
+            if (entry->symbol == symbol) {
                 // we finally found it!
                 return entry;
             }
@@ -130,7 +131,7 @@ SymbolEntry* symbol_table_lookup(SymbolTable* table, char* symbol)
 /**
  * Looks up a symbol in the symbol table at any scope level.
  */
-SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, char* symbol)
+SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, const char* symbol)
 {
     // get the symbol hash first
     unsigned int hash = symbol_hash(symbol);
@@ -141,7 +142,7 @@ SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, char* symbol)
         // the hash's location
         for (SymbolEntry* entry = map->entries[hash]; entry != NULL; entry = entry->next) {
             // check if the current entry matches the symbol we are looking for
-            if (strcmp(entry->symbol, symbol) == 0) {
+            if (entry->symbol == symbol) {
                 // we finally found it!
                 return entry;
             }
@@ -155,7 +156,7 @@ SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, char* symbol)
 /**
  * Inserts a symbol into the symbol table.
  */
-Error symbol_table_insert(SymbolTable* table, char* symbol, DataType type, SymbolFlags flags)
+Error symbol_table_insert(SymbolTable* table, const char* symbol, DataType type, SymbolFlags flags)
 {
     if (table->stack_top == NULL) {
         return error(E_BAD_POINTER, "No symbol table scope to insert into.");
@@ -261,13 +262,9 @@ Error symbol_table_destroy(SymbolTable** table)
 /**
  * Computes the hash of a symbol.
  *
- * Just a real simple hashing algorithm.
+ * Interned strings already carry their hash, so this is just a lookup.
  */
-unsigned int symbol_hash(char* symbol)
+unsigned int symbol_hash(const char* symbol)
 {
-    unsigned int hashval;
-    for (hashval = 0; *symbol != '\0'; symbol++) {
-        hashval = *symbol + 31 * hashval;
-    }
-    return hashval % SYMBOL_MAP_SIZE;
+    return intern_hash(symbol) % SYMBOL_MAP_SIZE;
 }
@@ -22,9 +22,9 @@ typedef enum {
  */
 typedef struct SymbolEntry {
     /**
-     * The symbol name as a string.
+     * The symbol name as an interned string.
      */
-    char* symbol;
+    const char* symbol;
 
     /**
      * The data type of the symbol.
@@ -80,6 +80,9 @@ typedef struct ScopeStackNode {
 
 /**
  * Stores a symbol table.
+ *
+ * All symbol names given to a symbol table must be interned strings, since
+ * symbols are compared by pointer.
  */
 typedef struct {
     /**
@@ -123,7 +126,7 @@ Error symbol_table_end_scope(SymbolTable* table);
  * @param  symbol The symbol to check.
  * @return        True if the symbol exists, otherwise false.
  */
-bool symbol_table_exists_local(SymbolTable* table, char* symbol);
+bool symbol_table_exists_local(SymbolTable* table, const char* symbol);
 
 /**
  * Looks up a symbol in the symbol table.
@@ -132,7 +135,7 @@ bool symbol_table_exists_local(SymbolTable* table, char* symbol);
  * @param  symbol The symbol to look up.
  * @return        A symbol table entry, or NULL if the symbol wasn't found.
  */
-SymbolEntry* symbol_table_lookup(SymbolTable* table, char* symbol);
+SymbolEntry* symbol_table_lookup(SymbolTable* table, const char* symbol);
 
 /**
  * Looks up a symbol in the symbol table in any scope.
@@ -141,7 +144,7 @@ SymbolEntry* symbol_table_lookup(SymbolTable* table, char* symbol);
  * @param  symbol The symbol to look up.
  * @return        A symbol table entry, or NULL if the symbol wasn't found.
  */
-SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, char* symbol);
+SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, const char* symbol);
 
 /**
  * Inserts a symbol into the symbol table.
@@ -152,7 +155,7 @@ SymbolEntry* symbol_table_lookup_anywhere(SymbolTable* table, char* symbol);
  * @param  flags  Optional symbol flags.
  * @return        An error code.
  */
-Error symbol_table_insert(SymbolTable* table, char* symbol, DataType type, SymbolFlags flags);
+Error symbol_table_insert(SymbolTable* table, const char* symbol, DataType type, SymbolFlags flags);
 
 /**
  * Pretty-prints a symbol table.
@@ -172,9 +175,9 @@ Error symbol_table_destroy(SymbolTable** table);
 /**
  * Computes the hash of a symbol.
  *
- * @param  symbol The symbol name string.
+ * @param  symbol The interned symbol name string.
  * @return        A numerical hash value.
  */
-unsigned int symbol_hash(char* symbol);
+unsigned int symbol_hash(const char* symbol);
 
 #endif
@@ -1,23 +1,50 @@
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 #include "error.h"
+#include "scanner.h"
 #include "tokens.h"
 
+// number of tokens a new token stream has room for
+#define TOKEN_STREAM_INITIAL_CAPACITY 256
+
 
 /**
  * Creates a new token.
  */
-Token token_create(char* file, int line, int column, TokenType type, char* lexeme)
+Token token_create(unsigned int file, TokenType type, long int offset, unsigned int length)
 {
-    // create the token
-    Token token = {file, line, column, type, NULL};
+    // the lexeme is not copied; the token only refers to the source text
+    Token token = {offset, 0, length, file, type, false};
+    return token;
+}
 
-    // allocate and copy the lexeme string
-    //token.lexeme = (char*)malloc(strlen(lexeme) + 1);
-    //strcpy(token.lexeme, lexeme);
-    token.lexeme = lexeme;
+/**
+ * Gets the name of the source file a token came from.
+ */
+char* token_file(Token token)
+{
+    return scanner_get_source(token.file)->file;
+}
 
-    return token;
+/**
+ * Gets the line number a token was found on in its source file.
+ */
+unsigned int token_line(Token token)
+{
+    unsigned int line, column;
+    scanner_locate(scanner_get_source(token.file), (long int)token.offset + token.length, &line, &column);
+    return line;
+}
+
+/**
+ * Gets the column number a token was found at in its source file.
+ */
+unsigned int token_column(Token token)
+{
+    unsigned int line, column;
+    scanner_locate(scanner_get_source(token.file), (long int)token.offset + token.length, &line, &column);
+    return column;
 }
 
 /**
@@ -27,8 +54,29 @@ TokenStream* token_stream_create()
 {
     // allocate the stream object
     TokenStream* stream = (TokenStream*)malloc(sizeof(TokenStream));
-    stream->head = stream->tail = NULL;
+    stream->capacity = TOKEN_STREAM_INITIAL_CAPACITY;
+    stream->tokens = (Token*)malloc(sizeof(Token) * stream->capacity);
     stream->length = 0;
+    stream->bounded = false;
+    return stream;
+}
+
+/**
+ * Creates a new bounded token stream that keeps only the most recent tokens.
+ */
+TokenStream* token_stream_create_bounded(long int window)
+{
+    // round the window up to a power of two so indices can be masked
+    long int capacity = 1;
+    while (capacity < window) {
+        capacity *= 2;
+    }
+
+    TokenStream* stream = (TokenStream*)malloc(sizeof(TokenStream));
+    stream->capacity = capacity;
+    stream->tokens = (Token*)malloc(sizeof(Token) * stream->capacity);
+    stream->length = 0;
+    stream->bounded = true;
     return stream;
 }
 
@@ -42,20 +90,38 @@ Error token_stream_push(TokenStream* stream, Token token)
         return E_BAD_POINTER;
     }
 
-    if (stream->head == NULL) {
-        stream->head = (TokenStreamNode*)malloc(sizeof(TokenStreamNode));
-        stream->head->token = token;
-        stream->tail = stream->head;
-    } else {
-        stream->tail->next = (TokenStreamNode*)malloc(sizeof(TokenStreamNode));
-        stream->tail->next->token = token;
-        stream->tail->next->previous = stream->tail;
-        stream->tail = stream->tail->next;
+    // grow the array geometrically so pushes are amortized constant time;
+    // bounded streams overwrite their oldest token instead
+    if (!stream->bounded && stream->length == stream->capacity) {
+        stream->capacity *= 2;
+        stream->tokens = (Token*)realloc(stream->tokens, sizeof(Token) * stream->capacity);
     }
 
+    stream->tokens[stream->length & (stream->capacity - 1)] = token;
+    stream->length++;
     return E_SUCCESS;
 }
 
+/**
+ * Gets the index of the oldest token still kept in a token stream.
+ */
+long int token_stream_first(TokenStream* stream)
+{
+    if (stream->bounded && stream->length > stream->capacity) {
+        return stream->length - stream->capacity;
+    }
+    return 0;
+}
+
+/**
+ * Gets a token from a token stream by its index.
+ */
+Token token_stream_get(TokenStream* stream, long int index)
+{
+    assert(index >= token_stream_first(stream) && index < stream->length);
+    return stream->tokens[index & (stream->capacity - 1)];
+}
+
 /**
  * Destroys a token stream and all its tokens and frees its memory.
  */
@@ -66,21 +132,8 @@ Error token_stream_destroy(TokenStream** stream)
         return E_BAD_POINTER;
     }
 
-    // make pointers to the nodes we are currently at
-    TokenStreamNode* current = (*stream)->head;
-    TokenStreamNode* next;
-
-    // run until the last node
-    while (current != NULL) {
-        // advance to the next node
-        next = current->next;
-        // destroy current node
-        free(current);
-        // get the next node before we destroy the current
-        current = next;
-    }
-
-    // free memory for stream
+    // free the token array and the stream itself
+    free((*stream)->tokens);
     free(*stream);
     *stream = NULL;
 
@@ -1,8 +1,15 @@
 #ifndef WALRUS_TOKENS_H
 #define WALRUS_TOKENS_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include "error.h"
 
+// the longest lexeme a token can refer to
+#define TOKEN_MAX_LENGTH UINT16_MAX
+
+// the largest int literal magnitude; 2^31 is only in range when negated
+#define TOKEN_INT_MAX 2147483648u
 
 /**
  * Types of lexical tokens.
@@ -56,85 +63,109 @@ typedef enum {
 
 /**
  * A structure representing a lexical token.
+ *
+ * Tokens are packed into 16 bytes so that four fit in a cache line. The lexeme
+ * is a slice of the source buffer, and the line and column are worked out from
+ * the offset only when they are needed.
  */
 typedef struct {
     /**
-     * The source file the token came from.
+     * The byte offset of the token lexeme in the source buffer.
+     */
+    uint32_t offset;
+
+    /**
+     * The intern id of the name for identifier tokens, the value for int
+     * literals, the intern id of the decoded contents for string and char
+     * literals, and otherwise 0.
      */
-    char* file;
+    uint32_t value;
 
     /**
-     * The line number the token was found in the source file.
+     * The length of the token lexeme in bytes.
      */
-    unsigned int line;
+    uint16_t length;
 
     /**
-     * The column number the token was found in the source file.
+     * The id of the source the token came from.
      */
-    unsigned int column;
+    uint16_t file;
 
     /**
      * The token type of the token.
      */
-    TokenType type;
+    uint8_t type;
 
     /**
-     * The token lexeme; the actual text of the token.
+     * Indicates if an int literal is larger than TOKEN_INT_MAX, in which case
+     * its value is meaningless.
      */
-    char* lexeme;
+    bool overflow;
 } Token;
 
 /**
- * A node in the token stream linked list.
+ * A structure storing a stream of tokens in a contiguous array.
+ *
+ * An unbounded stream grows to hold every token pushed onto it. A bounded
+ * stream is a ring buffer that only keeps the most recent tokens, so its memory
+ * use stays the same no matter how many tokens are pushed.
  */
-typedef struct TokenStreamNode {
-    /**
-     * Pointer to the previous node in the stream.
-     */
-    struct TokenStreamNode* previous;
-
-    /**
-     * Pointer to the next node in the stream.
-     */
-    struct TokenStreamNode* next;
-
+typedef struct {
     /**
-     * The token at the current node.
+     * The tokens in the stream. The token with index i is at i & (capacity - 1).
      */
-    Token token;
-} TokenStreamNode;
+    Token* tokens;
 
-/**
- * A structure storing a stream of tokens.
- */
-typedef struct {
     /**
-     * A pointer to the first node in the stream.
+     * The number of tokens ever pushed onto the token stream.
      */
-    TokenStreamNode* head;
+    long int length;
 
     /**
-     * A pointer to the last node in the stream.
+     * The number of tokens the array has room for; always a power of two.
      */
-    TokenStreamNode* tail;
+    long int capacity;
 
     /**
-     * The number of tokens in the token stream.
+     * Indicates if old tokens are overwritten instead of growing the array.
      */
-    int length;
+    bool bounded;
 } TokenStream;
 
 /**
  * Creates a new token.
  *
- * @param  file   The source file the token came from.
- * @param  line   The line number of the token.
- * @param  column The column number of the token.
+ * @param  file   The id of the source the token came from.
  * @param  type   The token type.
- * @param  lexeme The token lexeme.
+ * @param  offset The offset of the token lexeme in the source buffer.
+ * @param  length The length of the token lexeme.
  * @return        A newly created token.
  */
-Token token_create(char* file, int line, int column, TokenType type, char* lexeme);
+Token token_create(unsigned int file, TokenType type, long int offset, unsigned int length);
+
+/**
+ * Gets the name of the source file a token came from.
+ *
+ * @param  token The token.
+ * @return       The file name.
+ */
+char* token_file(Token token);
+
+/**
+ * Gets the line number a token was found on in its source file.
+ *
+ * @param  token The token.
+ * @return       The line number of the end of the token.
+ */
+unsigned int token_line(Token token);
+
+/**
+ * Gets the column number a token was found at in its source file.
+ *
+ * @param  token The token.
+ * @return       The column number of the end of the token.
+ */
+unsigned int token_column(Token token);
 
 /**
  * Creates a new token stream.
@@ -143,6 +174,14 @@ Token token_create(char* file, int line, int column, TokenType type, char* lexem
  */
 TokenStream* token_stream_create(void);
 
+/**
+ * Creates a new bounded token stream that keeps only the most recent tokens.
+ *
+ * @param  window The minimum number of recent tokens to keep.
+ * @return        A pointer to a shiny new token stream.
+ */
+TokenStream* token_stream_create_bounded(long int window);
+
 /**
  * Pushes a token onto the end of a token stream.
  *
@@ -152,6 +191,24 @@ TokenStream* token_stream_create(void);
  */
 Error token_stream_push(TokenStream* stream, Token token);
 
+/**
+ * Gets the index of the oldest token still kept in a token stream.
+ *
+ * @param  stream The stream to check.
+ * @return        The index of the oldest token available.
+ */
+long int token_stream_first(TokenStream* stream);
+
+/**
+ * Gets a token from a token stream by its index.
+ *
+ * @param  stream The stream to read from.
+ * @param  index  The index of the token; must be less than the stream length
+ *                and no less than token_stream_first().
+ * @return        The token at the given index.
+ */
+Token token_stream_get(TokenStream* stream, long int index);
+
 /**
  * Destroys a token stream and all its tokens and frees its memory.
  *
@@ -4,10 +4,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include "analyzer.h"
+#include "arena.h"
 #include "ast.h"
+#include "ast_flat.h"
 #include "iloc_generator.h"
+#include "intern.h"
 #include "lexer.h"
 #include "parser.h"
+#include "pass_manager.h"
 #include "scanner.h"
 #include "tokens.h"
 #include "walrus.h"
@@ -28,8 +32,11 @@ int main(int argc, char* const* argv)
                "Options:\r\n\r\n"
                "  --help                   Displays this help message, but you already knew that\r\n"
                "  --debug                  Writes debugging information to a debug file\r\n"
+               "  -a, --emit-ast           Writes the analyzed syntax tree to a binary .ast file\r\n"
                "  -p                       Scan and parse, but do not analyze\r\n"
                "  -s                       Scan only; do not parse or compile\r\n"
+               "  -j, --jobs <threads>     Lex each file up front on this many threads\r\n"
+               "  -t, --time-passes        Print the time spent in each compiler pass\r\n"
                "  -T, --print-tokens       Print out tokens as they are scanned\r\n\r\n"
                "This walrus knows how to avoid boredom.\r\n\r\n");
         return 0;
@@ -48,6 +55,10 @@ int main(int argc, char* const* argv)
     // run the compiler
     walrus_compile_all(options);
 
+    // identifiers stay interned across all files until we are done
+    intern_clear();
+    scanner_clear_sources();
+
     // exit with the last occurred error code
     return error_get_last();
 }
@@ -66,7 +77,9 @@ Error walrus_compile(char* filename, Options options)
     }
 
     // create a lexer for the file
-    Lexer* lexer = lexer_create(context);
+    Lexer* lexer = options.threads > 1
+        ? lexer_create_parallel(context, options.threads)
+        : lexer_create_bounded(context, PARSER_MAX_LOOKAHEAD);
 
     // manually scan
     if (options.scan_only) {
@@ -75,53 +88,62 @@ Error walrus_compile(char* filename, Options options)
             token = lexer_next(lexer);
 
             if (options.print_tokens && token.type != T_ILLEGAL && token.type != T_EOF) {
-                lexer_print_token(token);
+                lexer_print_token(lexer, token);
             }
         } while (token.type != T_EOF);
 
         // that's all we need to do; clean up and go
         lexer_destroy(&lexer);
+        scanner_close(&context);
         return E_SUCCESS;
     }
 
     // parse the program into an abstract syntax tree
-    ASTNode* ast = parser_parse(lexer);
-    SymbolTable* table;
+    int error_count = error_get_count();
+    Arena* arena = arena_create();
+    ASTNode* ast = parser_parse(lexer, arena);
+
+    // a tree with syntax errors in it isn't worth analyzing
+    bool analyze = !options.parse_only && error_get_count() == error_count;
 
-    if (!options.parse_only) {
-        // create a symbol table
-        table = symbol_table_create();
+    // create a symbol table
+    SymbolTable* table = symbol_table_create();
+    PassManager* passes = pass_manager_create(options.time_passes);
 
+    if (analyze) {
         // analyze and optimize the ast
-        analyzer_analyze(ast, table);
+        pass_manager_add(passes, analyzer_pass(table));
     }
 
     // print the ast if the user wants to see it
     if (options.debug) {
-        analyzer_write_debug_info(ast, table);
+        pass_manager_add(passes, analyzer_debug_pass(table));
     }
 
-    if (!options.parse_only) {
-        // if the program is perfect, start code generation
-        if (!error_get_last()) {
-            // generate the ILOC code
-            ILOCProgram* program = iloc_generator_generate(ast);
+    // save the analyzed tree so it can be loaded again without parsing
+    if (analyze && options.emit_ast) {
+        pass_manager_add(passes, ast_flat_pass());
+    }
 
-            // write it to program.iloc
-            iloc_generator_write(program, "program.iloc");
+    // if the program is perfect, generate the ILOC code into program.iloc
+    if (analyze) {
+        pass_manager_add(passes, iloc_generator_pass("program.iloc"));
+    }
 
-            // clean up
-            iloc_program_destroy(&program);
-        }
+    Error result = pass_manager_run(passes, ast);
 
-        // destroy table
-        symbol_table_destroy(&table);
+    if (options.time_passes) {
+        pass_manager_write_timings(passes, stdout);
     }
 
     // clean up after ourselves
-    ast_destroy(&ast);
+    pass_manager_destroy(&passes);
+    symbol_table_destroy(&table);
+    arena_destroy(&arena);
     lexer_destroy(&lexer);
     scanner_close(&context);
+
+    return result;
 }
 
 /**
@@ -144,13 +166,17 @@ Options parse_options(int argc, char* const* argv)
 {
     // create our options struct which contains our flags
     Options options = {0, 0, 0, 0, 0, 0, NULL};
+    options.threads = 1;
 
     // define our getopt specs
-    const char* short_options = "hdpsT";
+    const char* short_options = "hdpsTtaj:";
     static struct option long_options[] = {
         {"help",         no_argument, 0, 'h'},
         {"debug",        no_argument, 0, 'd'},
         {"print-tokens", no_argument, 0, 'T'},
+        {"jobs",   required_argument, 0, 'j'},
+        {"time-passes",  no_argument, 0, 't'},
+        {"emit-ast",     no_argument, 0, 'a'},
         {"bored",        no_argument, 0, 0},
         {0, 0, 0, 0}
     };
@@ -169,6 +195,12 @@ Options parse_options(int argc, char* const* argv)
             options.print_tokens = true;
         } else if (c == 0 && long_options[option_index].name == "bored") {
             options.bored = true;
+        } else if (c == 't') {
+            options.time_passes = true;
+        } else if (c == 'a') {
+            options.emit_ast = true;
+        } else if (c == 'j') {
+            options.threads = atoi(optarg);
         } else if (c == 'p') {
             options.parse_only = true;
         } else if (c == 's') {
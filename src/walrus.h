@@ -17,6 +17,9 @@ typedef struct {
     int files_count;
     char** files;
     bool bored;
+    int threads;
+    bool time_passes;
+    bool emit_ast;
 } Options;
 
 